@@ -0,0 +1,207 @@
+#ifndef BASELINESHPP
+#define BASELINESHPP
+
+#include <cctype>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+// Straightforward hand-written recursive descent parsers for the same
+// languages, computing the same checksums as grammars.hpp. They don't
+// allocate, which is what cpparsec is measured against.
+namespace bench::baselines {
+
+using std::string_view;
+
+class Cursor {
+public:
+  explicit Cursor(string_view str) : str(str) {}
+  bool done() const { return pos == str.size(); }
+  char peek() const { return done() ? '\0' : str[pos]; }
+  bool eat(char c) {
+    if (peek() != c || done())
+      return false;
+    pos++;
+    return true;
+  }
+  bool eat(string_view word) {
+    if (str.substr(pos, word.size()) != word)
+      return false;
+    pos += word.size();
+    return true;
+  }
+  void skipWhitespace() {
+    while (peek() == ' ' || peek() == '\n' || peek() == '\t')
+      pos++;
+  }
+  bool digits() {
+    std::size_t start = pos;
+    while (peek() >= '0' && peek() <= '9')
+      pos++;
+    return pos > start;
+  }
+
+private:
+  string_view str;
+  std::size_t pos = 0;
+};
+
+inline bool jsonString(Cursor &in) {
+  if (!in.eat('"'))
+    return false;
+  while (!in.done() && in.peek() != '"') {
+    if (in.eat('\\') && in.done())
+      return false;
+    in.eat(in.peek());
+  }
+  return in.eat('"');
+}
+
+inline std::optional<std::size_t> jsonValue(Cursor &in) {
+  in.skipWhitespace();
+  std::size_t count = 1;
+  if (in.peek() == '"') {
+    if (!jsonString(in))
+      return std::nullopt;
+  } else if (in.peek() == '-' || (in.peek() >= '0' && in.peek() <= '9')) {
+    in.eat('-');
+    if (!in.digits())
+      return std::nullopt;
+    if (in.eat('.') && !in.digits())
+      return std::nullopt;
+    if (in.eat('e') || in.eat('E')) {
+      if (!in.eat('+'))
+        in.eat('-');
+      if (!in.digits())
+        return std::nullopt;
+    }
+  } else if (in.eat("true") || in.eat("false") || in.eat("null")) {
+  } else if (in.peek() == '[' || in.peek() == '{') {
+    bool object = in.peek() == '{';
+    in.eat(in.peek());
+    char close = object ? '}' : ']';
+    in.skipWhitespace();
+    bool first = true;
+    while (!in.eat(close)) {
+      if (!first && !in.eat(','))
+        return std::nullopt;
+      first = false;
+      if (object) {
+        in.skipWhitespace();
+        if (!jsonString(in))
+          return std::nullopt;
+        in.skipWhitespace();
+        if (!in.eat(':'))
+          return std::nullopt;
+        count++;
+      }
+      auto inner = jsonValue(in);
+      if (!inner.has_value())
+        return std::nullopt;
+      count += inner.value();
+      in.skipWhitespace();
+    }
+  } else {
+    return std::nullopt;
+  }
+  in.skipWhitespace();
+  return count;
+}
+
+inline std::optional<std::size_t> json(string_view str) {
+  Cursor in(str);
+  auto count = jsonValue(in);
+  if (!in.done())
+    return std::nullopt;
+  return count;
+}
+
+inline std::optional<std::size_t> csv(string_view str) {
+  Cursor in(str);
+  std::size_t fields = 0;
+  while (!in.done()) {
+    do {
+      fields++;
+      if (in.eat('"')) {
+        while (in.eat("\"\"") || (!in.done() && in.peek() != '"'))
+          if (in.peek() != '"')
+            in.eat(in.peek());
+        if (!in.eat('"'))
+          return std::nullopt;
+      } else {
+        while (!in.done() && in.peek() != ',' && in.peek() != '"' &&
+               in.peek() != '\r' && in.peek() != '\n')
+          in.eat(in.peek());
+      }
+    } while (in.eat(','));
+    if (!in.eat("\r\n") && !in.done())
+      return std::nullopt;
+  }
+  return fields;
+}
+
+// same grammar as examples/evaluator.cpp: assign := sum ('=' assign)?,
+// sum := product ('+' product)*, product := unary ('*' unary)*,
+// unary := "++" unary | atom
+inline bool arithmeticAtom(Cursor &in, std::size_t &nodes) {
+  nodes++;
+  if (in.eat("++"))
+    return arithmeticAtom(in, nodes);
+  if (in.eat('('))
+    return in.digits() && in.eat(')');
+  if (in.digits())
+    return true;
+  bool letters = false;
+  while (std::isalpha(static_cast<unsigned char>(in.peek())) != 0) {
+    in.eat(in.peek());
+    letters = true;
+  }
+  return letters;
+}
+
+inline bool arithmeticProduct(Cursor &in, std::size_t &nodes) {
+  if (!arithmeticAtom(in, nodes))
+    return false;
+  while (in.eat('*')) {
+    nodes++;
+    if (!arithmeticAtom(in, nodes))
+      return false;
+  }
+  return true;
+}
+
+inline bool arithmeticSum(Cursor &in, std::size_t &nodes) {
+  if (!arithmeticProduct(in, nodes))
+    return false;
+  while (in.eat('+')) {
+    nodes++;
+    if (!arithmeticProduct(in, nodes))
+      return false;
+  }
+  return true;
+}
+
+inline bool arithmeticExpr(Cursor &in, std::size_t &nodes) {
+  if (!arithmeticSum(in, nodes))
+    return false;
+  if (!in.eat('='))
+    return true;
+  nodes++;
+  return arithmeticExpr(in, nodes);
+}
+
+inline std::optional<std::size_t> arithmetic(string_view str) {
+  std::size_t nodes = 0;
+  while (!str.empty()) {
+    std::size_t end = str.find('\n');
+    Cursor in(str.substr(0, end));
+    if (!arithmeticExpr(in, nodes) || !in.done())
+      return std::nullopt;
+    str = end == string_view::npos ? string_view() : str.substr(end + 1);
+  }
+  return nodes;
+}
+
+} // namespace bench::baselines
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef GENERATORSHPP
+#define GENERATORSHPP
+
+#include <cstdint>
+#include <string>
+
+// Deterministic inputs of roughly the requested size: the same size always
+// gives the same bytes, so runs are comparable across builds.
+namespace bench::generate {
+
+class Random {
+public:
+  explicit Random(std::uint64_t seed) : state(seed) {}
+  std::uint64_t next() { // splitmix64
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  std::size_t below(std::size_t n) { return next() % n; }
+
+private:
+  std::uint64_t state;
+};
+
+inline void word(std::string &out, Random &rng, std::size_t max_len = 10) {
+  std::size_t len = 1 + rng.below(max_len);
+  for (std::size_t i = 0; i < len; i++)
+    out.push_back(static_cast<char>('a' + rng.below(26)));
+}
+
+inline void number(std::string &out, Random &rng) {
+  out += std::to_string(rng.below(100000));
+}
+
+inline void jsonValue(std::string &out, Random &rng, int depth) {
+  switch (rng.below(depth > 0 ? 7 : 5)) {
+  case 0:
+    out.push_back('-');
+    number(out, rng);
+    out += ".25e3";
+    break;
+  case 1:
+    number(out, rng);
+    break;
+  case 2:
+    out.push_back('"');
+    word(out, rng);
+    out += rng.below(4) == 0 ? "\\\"\\u00e9" : "";
+    out.push_back('"');
+    break;
+  case 3:
+    out += rng.below(2) == 0 ? "true" : "false";
+    break;
+  case 4:
+    out += "null";
+    break;
+  case 5: {
+    out.push_back('[');
+    std::size_t n = rng.below(4);
+    for (std::size_t i = 0; i < n; i++) {
+      if (i > 0)
+        out += ", ";
+      jsonValue(out, rng, depth - 1);
+    }
+    out.push_back(']');
+    break;
+  }
+  default: {
+    out += "{ ";
+    std::size_t n = rng.below(4);
+    for (std::size_t i = 0; i < n; i++) {
+      if (i > 0)
+        out += ", ";
+      out.push_back('"');
+      word(out, rng);
+      out += "\": ";
+      jsonValue(out, rng, depth - 1);
+    }
+    out += " }";
+  }
+  }
+}
+
+// one top level array of records
+inline std::string json(std::size_t size) {
+  Random rng(size);
+  std::string out = "[\n";
+  for (std::size_t i = 0; out.size() < size; i++) {
+    if (i > 0)
+      out += ",\n";
+    out += "  {\"id\": ";
+    out += std::to_string(i);
+    out += ", \"name\": \"";
+    word(out, rng);
+    out += "\", \"value\": ";
+    jsonValue(out, rng, 3);
+    out += "}";
+  }
+  out += "\n]\n";
+  return out;
+}
+
+// RFC 4180: CRLF line breaks, quoted fields with commas, line breaks and
+// doubled quotes
+inline std::string csv(std::size_t size) {
+  Random rng(size);
+  std::string out = "id,name,comment,amount\r\n";
+  for (std::size_t i = 0; out.size() < size; i++) {
+    out += std::to_string(i);
+    out.push_back(',');
+    word(out, rng);
+    out.push_back(',');
+    switch (rng.below(4)) {
+    case 0:
+      out += "\"said \"\"";
+      word(out, rng);
+      out += "\"\", then left\"";
+      break;
+    case 1:
+      out += "\"two\r\nlines\"";
+      break;
+    case 2:
+      break; // empty field
+    default:
+      word(out, rng, 20);
+    }
+    out.push_back(',');
+    number(out, rng);
+    out += "\r\n";
+  }
+  return out;
+}
+
+// one expression per line in the syntax of examples/evaluator.cpp
+inline std::string arithmetic(std::size_t size) {
+  Random rng(size);
+  std::string out;
+  while (out.size() < size) {
+    if (rng.below(3) == 0) {
+      word(out, rng, 3);
+      out.push_back('=');
+    }
+    std::size_t terms = 1 + rng.below(8);
+    for (std::size_t i = 0; i < terms; i++) {
+      if (i > 0)
+        out.push_back(rng.below(2) == 0 ? '+' : '*');
+      switch (rng.below(4)) {
+      case 0:
+        word(out, rng, 3);
+        break;
+      case 1:
+        out.push_back('(');
+        number(out, rng);
+        out.push_back(')');
+        break;
+      case 2:
+        out += "++";
+        [[fallthrough]];
+      default:
+        number(out, rng);
+      }
+    }
+    out.push_back('\n');
+  }
+  return out;
+}
+
+} // namespace bench::generate
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef GRAMMARSHPP
+#define GRAMMARSHPP
+
+#include "Parser.hpp"
+#include "buildExpr.hpp"
+
+#include <string>
+#include <variant>
+
+// The workloads written with cpparsec. Every parser yields a checksum (values,
+// fields or expression nodes seen) that the baselines have to reproduce.
+namespace bench::grammars {
+
+using namespace cpparsec;
+using namespace cpparsec::Parsers;
+
+template <typename T> Parser<size_t> counted(const Parser<T> &parser) {
+  return parser.template map<size_t>(
+      [](const T &) { return std::make_optional<size_t>(1); });
+}
+
+// item (',' item)*, or nothing, summing the counts
+inline Parser<size_t> commaList(const Parser<size_t> &item) {
+  auto rest = zipAndGet<1>(skipSurrWhitespace(Character(',')), item);
+  return item.andThen(rest.zeroOrMore())
+             .map<size_t>([](const std::tuple<size_t, std::vector<size_t>> &t) {
+               size_t total = std::get<0>(t);
+               for (size_t n : std::get<1>(t))
+                 total += n;
+               return std::make_optional(total);
+             }) ||
+         Parser<size_t>([](string_view str) {
+           return std::make_optional(std::make_pair(size_t(0), str));
+         });
+}
+
+inline Parser<size_t> plusOne(const Parser<size_t> &parser) {
+  return parser.map<size_t>([](size_t n) { return std::make_optional(n + 1); });
+}
+
+// number of values, including the containers
+inline Parser<size_t> json() {
+  static Parser<size_t> value;
+  static const bool built = [] {
+    Parser<size_t> ref([](string_view str) { return value.parse(str); });
+    auto token = [](char c) { return skipSurrWhitespace(Character(c)); };
+
+    auto string = zipAndGet<1>(
+        Character('"'),
+        (Char_excluding_many(std::array{'"', '\\'}) ||
+         zipAndGet<1>(Character('\\'), Char))
+            .zeroOrMore(),
+        Character('"'));
+    auto digits = Digit.oneOrMore();
+    auto number = zipMany(
+        Optional(Character('-')), digits,
+        Optional(zip(Character('.'), digits)),
+        Optional(zip3(Characters(std::array{'e', 'E'}),
+                      Optional(Characters(std::array{'+', '-'})), digits)));
+    auto literal = oneOf(String("true"), String("false"), String("null"));
+    auto array = zipAndGet<1>(token('['), commaList(ref), token(']'));
+    auto member = zipAndGet<2>(skipPostWhitespace(string), token(':'), ref);
+    auto object =
+        zipAndGet<1>(token('{'), commaList(plusOne(member)), token('}'));
+
+    value = skipSurrWhitespace(oneOf(counted(string), counted(number),
+                                     counted(literal), plusOne(array),
+                                     plusOne(object)));
+    return true;
+  }();
+  (void)built;
+  return value;
+}
+
+// number of fields, one CRLF terminated record per line
+inline Parser<size_t> csvRecord() {
+  auto quoted = zipAndGet<1>(
+      Character('"'),
+      (Char_excluding('"') || zipAndGet<0>(Character('"'), Character('"')))
+          .zeroOrMore(),
+      Character('"'));
+  auto unquoted =
+      Char_excluding_many(std::array{',', '"', '\r', '\n'}).zeroOrMore();
+  auto field = counted(quoted || unquoted);
+  auto record = field.andThen(zipAndGet<1>(Character(','), field).zeroOrMore())
+                    .map<size_t>([](const std::tuple<size_t, std::vector<size_t>> &t) {
+                      return std::make_optional(1 + std::get<1>(t).size());
+                    });
+  return zipAndGet<0>(record, String("\r\n"));
+}
+
+// same atoms and operator table as examples/evaluator.cpp
+using Atom = std::variant<std::string_view, int>;
+
+inline const Parser<Atom> atom = oneOf(
+    Alpha.oneOrMoreSlice().map<Atom>([](string_view name) {
+      return std::make_optional<Atom>(Atom(name));
+    }),
+    oneOf(PosNum, Parens(PosNum)).map<Atom>([](size_t x) {
+      return std::make_optional<Atom>(Atom(int(x)));
+    }));
+
+inline Parser<Expr<Atom>> arithmetic() {
+  // the parser only refers to the table
+  static std::vector<ExprType> table{
+      INFIX("=", "Assign", Assoc::Right), INFIX("+", "Add", Assoc::Left),
+      INFIX("*", "Mul", Assoc::Left), PREFIX("++", "PreIncr", Assoc::Right)};
+  return buildExpressionParser(table, atom);
+}
+
+inline size_t nodes(const Expr<Atom> &expr) {
+  return std::visit(
+      [](auto &&x) -> size_t {
+        using T = std::decay_t<decltype(x)>;
+        if constexpr (std::is_same_v<T, InfixOperation<Atom>>)
+          return 1 + nodes(*x.lhs) + nodes(*x.rhs);
+        else if constexpr (std::is_same_v<T, Atom>)
+          return 1;
+        else
+          return 1 + nodes(*x.a);
+      },
+      expr.tree);
+}
+
+} // namespace bench::grammars
+
+#endif
@@ -0,0 +1,98 @@
+#define CPPARSEC_COUNT_ALLOCATIONS
+#include "harness.hpp"
+#include "allocCount.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench {
+
+std::size_t allocations() { return cpparsec::alloc::totals.allocations; }
+
+static Result run(const Generator &generate, const Workload &parse,
+                  std::size_t size, double min_seconds) {
+  using Clock = std::chrono::steady_clock;
+  std::string input = generate(size);
+  Result res;
+  res.bytes = input.size();
+
+  std::size_t runs = 0;
+  std::size_t allocs_before = allocations();
+  auto start = Clock::now();
+  double elapsed = 0;
+  do {
+    auto checksum = parse(input);
+    if (!checksum.has_value())
+      return res;
+    res.checksum = checksum.value();
+    runs++;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < min_seconds);
+
+  res.ok = true;
+  res.seconds = elapsed / runs;
+  res.allocations = double(allocations() - allocs_before) / runs;
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  res.peak_rss_kb = usage.ru_maxrss;
+  return res;
+}
+
+Result measure(const Generator &generate, const Workload &parse,
+               std::size_t size, double min_seconds) {
+  int fds[2];
+  if (pipe(fds) != 0)
+    throw std::runtime_error("pipe failed");
+  pid_t pid = fork();
+  if (pid < 0)
+    throw std::runtime_error("fork failed");
+  if (pid == 0) {
+    close(fds[0]);
+    Result res = run(generate, parse, size, min_seconds);
+    ssize_t written = write(fds[1], &res, sizeof(res));
+    _exit(written == sizeof(res) ? 0 : 1);
+  }
+
+  close(fds[1]);
+  Result res;
+  if (read(fds[0], &res, sizeof(res)) != sizeof(res))
+    res = Result{}; // the child died, e.g. out of memory
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return res;
+}
+
+std::size_t parseSize(std::string_view str) {
+  std::size_t pos = 0;
+  std::size_t n = std::stoull(std::string(str), &pos);
+  switch (pos < str.size() ? str[pos] : ' ') {
+  case 'G':
+  case 'g':
+    return n << 30;
+  case 'M':
+  case 'm':
+    return n << 20;
+  case 'K':
+  case 'k':
+    return n << 10;
+  default:
+    return n;
+  }
+}
+
+std::string formatSize(std::size_t bytes) {
+  const char *units[] = {"B", "KB", "MB", "GB"};
+  int unit = 0;
+  while (bytes >= 1024 && bytes % 1024 == 0 && unit < 3) {
+    bytes /= 1024;
+    unit++;
+  }
+  return std::to_string(bytes) + units[unit];
+}
+
+} // namespace bench
@@ -0,0 +1,42 @@
+#ifndef HARNESSHPP
+#define HARNESSHPP
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+// operator new calls made by this thread so far
+std::size_t allocations();
+
+struct Result {
+  bool ok = false; // false if the parse failed or the run crashed
+  double seconds = 0; // per run
+  std::size_t bytes = 0;
+  double allocations = 0; // per run
+  std::size_t peak_rss_kb = 0;
+  std::size_t checksum = 0;
+
+  double mb_per_second() const { return bytes / seconds / (1 << 20); }
+  double allocations_per_byte() const { return allocations / bytes; }
+};
+
+using Generator = std::function<std::string(std::size_t)>;
+using Workload = std::function<std::optional<std::size_t>(std::string_view)>;
+
+// Generates an input of about `size` bytes and parses it in a child process,
+// so that peak RSS and allocation counts of one run don't leak into the
+// next. Small inputs are parsed repeatedly for at least min_seconds.
+Result measure(const Generator &generate, const Workload &parse,
+               std::size_t size, double min_seconds = 0.2);
+
+// "64K", "1M", "1G" ...
+std::size_t parseSize(std::string_view str);
+std::string formatSize(std::size_t bytes);
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,121 @@
+// End-to-end benchmarks: JSON, CSV and the arithmetic grammar of
+// examples/evaluator.cpp, each parsed with cpparsec and with a hand-written
+// baseline at several input sizes.
+//
+//   workloads [--sizes=1K,1M,16M] [--min-seconds=0.2] [json|csv|arithmetic...]
+
+#include "baselines.hpp"
+#include "generators.hpp"
+#include "grammars.hpp"
+#include "harness.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Workload {
+  const char *name;
+  bench::Generator generate;
+  bench::Workload cpparsec, baseline;
+};
+
+std::optional<size_t> parseJson(string_view input) {
+  auto res = bench::grammars::json().parse(input);
+  if (!res.has_value() || !res.value().second.empty())
+    return std::nullopt;
+  return res.value().first;
+}
+
+std::optional<size_t> parseCsv(string_view input) {
+  static const auto record = bench::grammars::csvRecord();
+  size_t fields = 0;
+  while (!input.empty()) {
+    auto res = record.parse(input);
+    if (!res.has_value())
+      return std::nullopt;
+    fields += res.value().first;
+    input = res.value().second;
+  }
+  return fields;
+}
+
+std::optional<size_t> parseArithmetic(string_view input) {
+  static const auto expr = bench::grammars::arithmetic();
+  size_t nodes = 0;
+  while (!input.empty()) {
+    size_t end = input.find('\n');
+    auto res = expr.parse(input.substr(0, end));
+    if (!res.has_value() || !res.value().second.empty())
+      return std::nullopt;
+    nodes += bench::grammars::nodes(res.value().first);
+    input = end == string_view::npos ? string_view() : input.substr(end + 1);
+  }
+  return nodes;
+}
+
+void report(const char *workload, size_t size, const char *impl,
+            const bench::Result &res, const bench::Result *baseline) {
+  std::printf("%-11s %6s %-9s", workload, bench::formatSize(size).c_str(),
+              impl);
+  if (!res.ok) {
+    std::printf(" %10s\n", "FAILED");
+    return;
+  }
+  std::printf(" %10.2f %12.3f %10.1f %12zu", res.mb_per_second(),
+              res.allocations_per_byte(), res.peak_rss_kb / 1024.0,
+              res.checksum);
+  if (baseline != nullptr && baseline->ok)
+    std::printf(" %8.1f%%%s",
+                100 * res.mb_per_second() / baseline->mb_per_second(),
+                res.checksum == baseline->checksum ? "" : " (checksum differs)");
+  std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<Workload> workloads{
+      {"json", bench::generate::json, parseJson, bench::baselines::json},
+      {"csv", bench::generate::csv, parseCsv, bench::baselines::csv},
+      {"arithmetic", bench::generate::arithmetic, parseArithmetic,
+       bench::baselines::arithmetic},
+  };
+  std::vector<size_t> sizes{1 << 10, 1 << 20, 16 << 20};
+  double min_seconds = 0.2;
+  std::vector<std::string> only;
+
+  for (int i = 1; i < argc; i++) {
+    string_view arg = argv[i];
+    if (arg.starts_with("--sizes=")) {
+      sizes.clear();
+      arg.remove_prefix(std::strlen("--sizes="));
+      while (!arg.empty()) {
+        size_t comma = arg.find(',');
+        sizes.push_back(bench::parseSize(arg.substr(0, comma)));
+        arg = comma == string_view::npos ? string_view() : arg.substr(comma + 1);
+      }
+    } else if (arg.starts_with("--min-seconds=")) {
+      min_seconds = std::stod(argv[i] + std::strlen("--min-seconds="));
+    } else {
+      only.emplace_back(arg);
+    }
+  }
+
+  std::printf("%-11s %6s %-9s %10s %12s %10s %12s %9s\n", "workload", "size",
+              "impl", "MB/s", "allocs/byte", "peak MB", "checksum",
+              "vs base");
+  for (auto &w : workloads) {
+    if (!only.empty() && std::find(only.begin(), only.end(), w.name) == only.end())
+      continue;
+    for (size_t size : sizes) {
+      auto base = bench::measure(w.generate, w.baseline, size, min_seconds);
+      auto lib = bench::measure(w.generate, w.cpparsec, size, min_seconds);
+      report(w.name, size, "baseline", base, nullptr);
+      report(w.name, size, "cpparsec", lib, &base);
+      std::fflush(stdout);
+    }
+  }
+}
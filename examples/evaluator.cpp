@@ -1,11 +1,20 @@
 #include "Parser.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
 
-using Atom = std::variant<std::string, int>;
+// names are views into the input line, which outlives the tree
+using Atom = std::variant<std::string_view, int>;
 
 std::ostream &operator<<(std::ostream &out,
-                         const std::variant<std::string, int> &x) {
+                         const std::variant<std::string_view, int> &x) {
   std::visit([&out](auto &&y) { out << y; }, x);
   return out;
 }
@@ -15,26 +24,27 @@ std::ostream &operator<<(std::ostream &out,
 using namespace cpparsec;
 using namespace cpparsec::Parsers;
 
-Parser<Atom>
-    atom_parser(Fn<std::optional<pair<Atom, string_view>>(string_view)>(
-        []([[maybe_unused]] string_view str)
-            -> std::optional<pair<Atom, string_view>> {
-          return oneOf(Alpha.oneOrMore().map<Atom>(
-                           [](const std::vector<char> &vec) {
-                             return std::make_optional<Atom>(
-                                 Atom(std::string(vec.begin(), vec.end())));
-                           }),
-                       oneOf(PosNum, Parens(PosNum)).map<Atom>([](int x) {
-                         return std::make_optional<Atom>(Atom(int(x)));
-                       }))
-              .parse(str);
-        }));
-
-std::unordered_map<std::string, int> sym_table;
-
-std::optional<int> evaluate(const Expr<Atom> &tree) {
+const Parser<Atom> atom_parser = oneOf(
+    Alpha.oneOrMoreSlice().map<Atom>([](string_view name) {
+      return std::make_optional<Atom>(Atom(name));
+    }),
+    oneOf(PosNum, Parens(PosNum)).map<Atom>([](int x) {
+      return std::make_optional<Atom>(Atom(int(x)));
+    }));
+
+// owned by the caller, so evaluations on different threads don't share it
+struct NameHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view name) const {
+    return std::hash<std::string_view>{}(name);
+  }
+};
+using SymbolTable =
+    std::unordered_map<std::string, int, NameHash, std::equal_to<>>;
+
+std::optional<int> evaluate(const Expr<Atom> &tree, SymbolTable &sym_table) {
   return std::visit(
-      [](auto &&x) -> std::optional<int> {
+      [&sym_table](auto &&x) -> std::optional<int> {
         using T = std::decay_t<decltype(x)>;
         // using U = typename T_of_Expr<T>::type;
         using U = Atom;
@@ -42,17 +52,18 @@ std::optional<int> evaluate(const Expr<Atom> &tree) {
           return std::nullopt;
         } else if constexpr (std::is_same_v<T, PrefixOperation<U>>) {
           const PrefixOperation<U> &op = x;
-          auto res = evaluate(*(op.a));
+          auto res = evaluate(*(op.a), sym_table);
           RETURN_NULLOPT_IF_NO_VALUE(res);
           return std::visit(
-              [res](auto &&a) -> std::optional<int> {
+              [res, &sym_table](auto &&a) -> std::optional<int> {
                 using V = std::remove_reference_t<decltype(a)>;
                 if constexpr (std::is_same_v<V, Atom>) {
                   return std::visit(
                       [&](auto &&at) mutable -> std::optional<int> {
                         using W = std::decay_t<decltype(at)>;
-                        if constexpr (std::is_same_v<W, std::string>) {
-                          sym_table[at] = res.value() + 1;
+                        if constexpr (std::is_same_v<W, std::string_view>) {
+                          sym_table.insert_or_assign(std::string(at),
+                                                     res.value() + 1);
                           return std::make_optional<int>(res.value() + 1);
                         } else {
                           return std::make_optional<int>(res.value() + 1);
@@ -66,18 +77,20 @@ std::optional<int> evaluate(const Expr<Atom> &tree) {
 
         } else if constexpr (std::is_same_v<T, InfixOperation<U>>) {
           const InfixOperation<U> &op = x;
-          auto right = evaluate(*(op.rhs));
+          auto right = evaluate(*(op.rhs), sym_table);
           RETURN_NULLOPT_IF_NO_VALUE(right);
           if (op.type == "Assign") {
             return std::visit(
-                [right](auto &&y) mutable -> std::optional<int> {
+                [right, &sym_table](auto &&y) mutable -> std::optional<int> {
                   using V = std::decay_t<decltype(y)>;
                   if constexpr (std::is_same_v<V, Atom>) {
                     return std::visit(
-                        [right](auto &&z) mutable -> std::optional<int> {
+                        [right,
+                         &sym_table](auto &&z) mutable -> std::optional<int> {
                           using W = std::decay_t<decltype(z)>;
-                          if constexpr (std::is_same_v<W, std::string>) {
-                            sym_table[z] = right.value();
+                          if constexpr (std::is_same_v<W, std::string_view>) {
+                            sym_table.insert_or_assign(std::string(z),
+                                                       right.value());
                             return std::make_optional(right.value());
                           } else {
                             return std::nullopt;
@@ -90,21 +103,22 @@ std::optional<int> evaluate(const Expr<Atom> &tree) {
                 },
                 op.lhs->tree);
           } else if (op.type == "Add") {
-            auto left = evaluate(*(op.lhs));
+            auto left = evaluate(*(op.lhs), sym_table);
             RETURN_NULLOPT_IF_NO_VALUE(left);
             return std::make_optional(left.value() + right.value());
           } else {
-            auto left = evaluate(*(op.lhs));
+            auto left = evaluate(*(op.lhs), sym_table);
             RETURN_NULLOPT_IF_NO_VALUE(left);
             return std::make_optional(left.value() * right.value());
           }
         } else { // means its Atom
           return std::visit(
-              [](auto &&at) -> std::optional<int> {
+              [&sym_table](auto &&at) -> std::optional<int> {
                 using V = std::decay_t<decltype(at)>;
-                if constexpr (std::is_same_v<V, std::string>) {
-                  if (sym_table.find(at) != sym_table.end())
-                    return std::make_optional<int>(sym_table[at]);
+                if constexpr (std::is_same_v<V, std::string_view>) {
+                  auto it = sym_table.find(at);
+                  if (it != sym_table.end())
+                    return std::make_optional<int>(it->second);
                   return std::nullopt;
                 } else {
                   return std::make_optional<int>(at);
@@ -116,14 +130,15 @@ std::optional<int> evaluate(const Expr<Atom> &tree) {
       tree.tree);
 }
 
-void parseArithmeticExpr(const std::string &input) {
-  std::vector<ExprType> table{
-      INFIX("=", "Assign", Assoc::Right), INFIX("+", "Add", Assoc::Left),
-      INFIX("*", "Mul", Assoc::Left), PREFIX("++", "PreIncr", Assoc::Right)};
-  // std::string input("x=1+2*3+4*10");
-  // std::string input("3+4");
+std::vector<ExprType> op_table{
+    INFIX("=", "Assign", Assoc::Right), INFIX("+", "Add", Assoc::Left),
+    INFIX("*", "Mul", Assoc::Left), PREFIX("++", "PreIncr", Assoc::Right)};
+// built once, the table has to outlive it
+const Parser<Expr<Atom>> expr_parser =
+    buildExpressionParser(op_table, atom_parser);
+
+void parseArithmeticExpr(const std::string &input, SymbolTable &sym_table) {
   std::cout << "Tree for arithmetic expression parsing of " << input << "\n";
-  auto expr_parser = buildExpressionParser(table, atom_parser);
   auto expr = expr_parser.parse(input);
   if (!expr.has_value() || expr.value().second != "") {
     std::cout << "Invalid parse\n";
@@ -131,7 +146,7 @@ void parseArithmeticExpr(const std::string &input) {
   }
   std::cout << expr->first << '\n';
   std::cout << expr->second << '\n';
-  std::optional<int> eval = evaluate(expr.value().first);
+  std::optional<int> eval = evaluate(expr.value().first, sym_table);
   if (eval.has_value()) {
     std::cout << eval.value() << '\n';
   } else {
@@ -139,11 +154,110 @@ void parseArithmeticExpr(const std::string &input) {
   }
 }
 
-int main() {
+// collects output and hands it to stdio in large blocks
+class BufferedWriter {
+public:
+  explicit BufferedWriter(std::FILE *out) : out(out) { buf.reserve(limit); }
+  ~BufferedWriter() { flush(); }
+
+  void write(std::string_view str) {
+    if (buf.size() + str.size() > limit)
+      flush();
+    buf.append(str);
+  }
+  void write(int x) {
+    char digits[16];
+    auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), x);
+    write(std::string_view(digits, end - digits));
+  }
+  void flush() {
+    std::fwrite(buf.data(), 1, buf.size(), out);
+    buf.clear();
+  }
+
+private:
+  static constexpr std::size_t limit = 1 << 16;
+  std::FILE *out;
+  std::string buf;
+};
+
+// Evaluates every line of in, writing one result per line to stdout, and
+// reports throughput and per-line latency to stderr.
+int runBatch(std::istream &in) {
+  using Clock = std::chrono::steady_clock;
+  std::string input((std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+  SymbolTable sym_table;
+  BufferedWriter out(stdout);
+  std::vector<std::chrono::nanoseconds> latencies;
+  std::size_t invalid = 0;
+
+  auto started = Clock::now();
+  std::string_view rest = input;
+  while (!rest.empty()) {
+    std::size_t eol = std::min(rest.find('\n'), rest.size());
+    std::string_view line = rest.substr(0, eol);
+    rest.remove_prefix(std::min(eol + 1, rest.size()));
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+
+    auto before = Clock::now();
+    std::optional<int> eval;
+    auto expr = expr_parser.parse(line);
+    if (expr.has_value() && expr.value().second.empty())
+      eval = evaluate(expr.value().first, sym_table);
+    latencies.push_back(Clock::now() - before);
+
+    if (eval.has_value()) {
+      out.write(eval.value());
+    } else {
+      out.write("Invalid");
+      invalid++;
+    }
+    out.write("\n");
+  }
+  out.flush();
+  std::chrono::duration<double> elapsed = Clock::now() - started;
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    if (latencies.empty())
+      return 0.0;
+    std::size_t at = static_cast<std::size_t>(p * (latencies.size() - 1));
+    return std::chrono::duration<double, std::micro>(latencies[at]).count();
+  };
+  std::fprintf(stderr,
+               "%zu lines (%zu invalid) in %.3fs, %.0f lines/s\n"
+               "latency us: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  "
+               "max %.2f\n",
+               latencies.size(), invalid, elapsed.count(),
+               latencies.size() / std::max(elapsed.count(), 1e-9),
+               percentile(0.5), percentile(0.9), percentile(0.99),
+               percentile(0.999), percentile(1.0));
+  return 0;
+}
+
+// evaluator                  read-eval-print loop on stdin
+// evaluator --batch [file]   evaluate every line of file (default stdin)
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string_view(argv[1]) == "--batch") {
+    if (argc < 3 || std::string_view(argv[2]) == "-")
+      return runBatch(std::cin);
+    std::ifstream file(argv[2], std::ios::binary);
+    if (!file) {
+      std::fprintf(stderr, "cannot open %s\n", argv[2]);
+      return 1;
+    }
+    return runBatch(file);
+  }
+
   std::string input;
+  SymbolTable sym_table;
   while (true) {
     std::cout << ">>>";
-    std::getline(std::cin, input);
-    parseArithmeticExpr(input);
+    if (!std::getline(std::cin, input))
+      break;
+    parseArithmeticExpr(input, sym_table);
   }
+  std::cout << '\n';
 }
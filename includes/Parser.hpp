@@ -1,16 +1,25 @@
 #ifndef PARSERHPP
 #define PARSERHPP
 
+#include "budget.hpp"
+#include "cut.hpp"
+#include "heatmap.hpp"
+#include "stackSafe.hpp"
 #include "util.hpp"
 
 #include <algorithm>
+#include <charconv>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #define RETURN_NULLOPT_IF_NO_VALUE(opt)                                        \
@@ -34,12 +43,84 @@ using opt_string_view = std::optional<std::string_view>;
 template <typename T> using Fn = std::function<T>;
 
 namespace cpparsec {
+
+// What a Parser<T> calls. A function without captures is kept as a plain
+// function pointer, so a parser made from one is a constant: it needs no
+// heap and no static initializer (see the primitives in Parsers). Any other
+// callable lives on the heap and is shared by all copies, so copying a
+// parser never copies what its lambda captured. It is only ever called as
+// const, which keeps mutable lambdas out: copies and threads share it.
+template <typename T> class ParseFn {
+public:
+  using Result = std::optional<pair<T, string_view>>;
+  using Pointer = Result (*)(string_view);
+  // a function that reads the input itself (see primitive below)
+  struct Primitive {
+    Pointer fn;
+  };
+
+  constexpr ParseFn() = default;
+  template <typename F>
+    requires std::is_convertible_v<F, Pointer>
+  constexpr ParseFn(F f) : plain(f) {}
+  constexpr ParseFn(Primitive p) : plain(p.fn), reports(true) {}
+  template <typename F>
+    requires(!std::is_convertible_v<F, Pointer> &&
+             !std::is_same_v<std::decay_t<F>, ParseFn> &&
+             std::is_invocable_r_v<Result, const std::decay_t<F> &,
+                                   string_view>)
+  ParseFn(F f) : boxed(std::make_shared<const Holder<F>>(std::move(f))) {}
+
+  Result operator()(string_view str) const {
+    budget::Guard guard;
+    if (plain == nullptr) {
+      if (boxed == nullptr)
+        throw std::bad_function_call();
+      return boxed->call(str);
+    }
+    Result res = plain(str);
+    if (reports && heat::recorder != nullptr) [[unlikely]]
+      heat::recorder->examined(
+          str, res.has_value() ? str.size() - res.value().second.size() : 1);
+    return res;
+  }
+  explicit operator bool() const {
+    return plain != nullptr || boxed != nullptr;
+  }
+
+private:
+  struct Callable {
+    virtual ~Callable() = default;
+    virtual Result call(string_view str) const = 0;
+  };
+  template <typename F> struct Holder final : Callable {
+    const F f;
+    explicit Holder(F f) : f(std::move(f)) {}
+    Result call(string_view str) const override { return f(str); }
+  };
+
+  Pointer plain = nullptr;
+  bool reports = false;
+  std::shared_ptr<const Callable> boxed;
+};
+
+// Marks fn as a primitive: it examines the input itself instead of calling
+// other parsers, so the bytes it consumed, or the one it rejected, are
+// reported to the heatmap. Other functions are not, their reads are
+// reported by the primitives they call.
+template <typename T>
+constexpr typename ParseFn<T>::Primitive
+primitive(std::optional<pair<T, string_view>> (*fn)(string_view)) {
+  return {fn};
+}
+
 template <typename T> class Parser {
 public:
-  std::function<std::optional<pair<T, string_view>>(string_view)> parse;
+  ParseFn<T> parse;
   Parser() = default;
-  Parser(std::function<std::optional<pair<T, string_view>>(string_view)> f)
-      : parse(f) {}
+  template <typename F>
+    requires std::constructible_from<ParseFn<T>, F>
+  constexpr Parser(F f) : parse(std::move(f)) {}
   Parser(const T &val) = delete;
   Parser(const Parser<T> &other) = default;
   Parser<T> &operator=(Parser<T> &&other) = default;
@@ -49,42 +130,45 @@ public:
       auto x = this_obj.parse(str);
 
       RETURN_OPT_IF_HAS_VALUE(x);
+      cut::checkRewind(str);
       return other.parse(str);
     });
   }
 
-  Parser<T> filter(std::function<bool(T)> pred) const {
-    std::function<std::optional<T>(T)> f =
-        [pred](const T &x) -> std::optional<T> {
-      return (pred(x) ? std::make_optional(x) : std::nullopt);
-    };
-    return map<T>(f);
+  // Neither filter nor map builds a parser per match: the result of this
+  // is checked or transformed in place.
+  template <typename Pred>
+    requires std::is_invocable_r_v<bool, const Pred &, const T &>
+  Parser<T> filter(Pred pred) const {
+    return Parser<T>([pred = std::move(pred), this_obj = *this](string_view str)
+                         -> std::optional<pair<T, string_view>> {
+      auto x = this_obj.parse(str);
+      if (x.has_value() && !pred(std::as_const(x.value().first)))
+        return std::nullopt;
+      return x;
+    });
   }
 
-  template <typename B>
-  Parser<B> map(std::function<std::optional<B>(T)> f) const {
-    std::function<Parser<B>(T)> g([f = std::move(f)](
-                                      const T &match) -> Parser<B> {
-      return Parser<B>(
-          std::function<std::optional<pair<B, string_view>>(string_view)>(
-              // f and match are the captures
-              [f = std::move(f), match](
-                  string_view str) -> std::optional<std::pair<B, string_view>> {
-                std::optional<B> x = f(match);
-                // if (x.has_value()) {
-                //	 return std::make_pair(x.value(), str);
-                // } else {
-                //	 return std::nullopt;
-                // }
-                //
-                RETURN_NULLOPT_IF_NO_VALUE(x);
-                // else this
-                return std::make_pair(std::move(x.value()), str);
-              }));
+  // f gives a std::optional<B>, no value failing the parse. B is deduced
+  // from f unless given.
+  template <typename B = void, typename F>
+    requires std::is_invocable_v<const F &, T>
+  auto map(F f) const {
+    using R = std::conditional_t<
+        std::is_void_v<B>,
+        typename std::invoke_result_t<const F &, T>::value_type, B>;
+    return Parser<R>([f = std::move(f), this_obj = *this](string_view str)
+                         -> std::optional<pair<R, string_view>> {
+      auto x = this_obj.parse(str);
+      RETURN_NULLOPT_IF_NO_VALUE(x);
+      std::optional<R> y = f(std::move(x.value().first));
+      RETURN_NULLOPT_IF_NO_VALUE(y);
+      return std::make_pair(std::move(y.value()), x.value().second);
     });
-    return this->flatmap<B>(std::move(g));
   }
 
+  // for grammars where what comes next depends on the value parsed, f
+  // builds the parser to continue with on every match
   template <typename B> Parser<B> flatmap(std::function<Parser<B>(T)> f) const {
     return Parser<B>([f = std::move(f), this_obj = *this](string_view str)
                          -> std::optional<std::pair<B, string_view>> {
@@ -104,16 +188,38 @@ public:
         [](const std::vector<T> &vec) { return !vec.empty(); });
   }
 
+  // like zeroOrMore/oneOrMore, but give back the consumed input instead of
+  // collecting the values
+  Parser<string_view> zeroOrMoreSlice() const {
+    return Parser<string_view>([this_obj = *this](string_view str) {
+      string_view rest = str;
+      std::optional<std::pair<T, string_view>> parseRes = this_obj.parse(rest);
+      while (parseRes.has_value()) {
+        rest = parseRes.value().second;
+        parseRes = this_obj.parse(rest);
+      }
+      cut::checkRewind(rest);
+      return std::make_optional(
+          std::make_pair(str.substr(0, str.size() - rest.size()), rest));
+    });
+  }
+
+  Parser<string_view> oneOrMoreSlice() const {
+    return this->zeroOrMoreSlice().filter(
+        [](string_view slice) { return !slice.empty(); });
+  }
+
   Parser<std::vector<T>> zeroOrMore() const {
     return Parser<std::vector<T>>([this_obj = *this](string_view str) {
       std::vector<T> matches;
       std::optional<std::pair<T, string_view>> parseRes = this_obj.parse(str);
       while (parseRes.has_value()) {
-        matches.push_back(parseRes.value().first);
+        matches.push_back(std::move(parseRes.value().first));
         str = parseRes.value().second;
         parseRes = this_obj.parse(str);
       }
-      return std::make_optional(std::make_pair(matches, str));
+      cut::checkRewind(str);
+      return std::make_optional(std::make_pair(std::move(matches), str));
     });
   }
 
@@ -172,7 +278,7 @@ public:
 }; // Parser class end
 
 // char template specializtion for Parser
-template <> Parser<char>::Parser(const char &c) {
+template <> inline Parser<char>::Parser(const char &c) {
   this->parse = ([c](string_view str) {
     return str.empty() ? std::nullopt
            : (str[0] == c)
@@ -183,7 +289,8 @@ template <> Parser<char>::Parser(const char &c) {
 
 // orThrow specialization for bool types
 // We want it to throw when it returns false
-template <> Parser<bool> Parser<bool>::orThrow(const char *error_msg) {
+template <>
+inline Parser<bool> Parser<bool>::orThrow(const char *error_msg) {
   return Parser<bool>([*this, error_msg](string_view str) {
     auto res = this->parse(str);
     // not checking for nullopt cuz bool shouldn't return nullopt
@@ -198,7 +305,9 @@ template <> Parser<bool> Parser<bool>::orThrow(const char *error_msg) {
 namespace Parsers { // Parsers::
 
 template <typename T> Parser<T> lazy(Fn<Parser<T>()> fn) {
-  return Parser<T>([fn](string_view str) { return fn().parse(str); });
+  return Parser<T>([fn](string_view str) {
+    return growStack([&] { return fn().parse(str); });
+  });
 }
 
 template <typename A, typename B>
@@ -234,6 +343,104 @@ auto zipAndGet(const Parser<T> &...parsers) {
                });
 }
 
+// Applicative sequencing: the parsers run one after another and f is
+// applied to all of their values, with no tuple or intermediate parser in
+// between. seq(f, a, b) is liftA2 f a b.
+template <typename F, typename... T>
+  requires std::is_invocable_v<const F &, T...>
+auto seq(F f, const Parser<T> &...parsers) {
+  using R = std::invoke_result_t<const F &, T...>;
+  return Parser<R>([f = std::move(f), ps = std::make_tuple(parsers...)](
+                       string_view str) -> std::optional<pair<R, string_view>> {
+    std::tuple<std::optional<T>...> values;
+    auto step = [&]<std::size_t I>(std::integral_constant<std::size_t, I>) {
+      auto res = std::get<I>(ps).parse(str);
+      if (!res.has_value())
+        return false;
+      std::get<I>(values).emplace(std::move(res.value().first));
+      str = res.value().second;
+      return true;
+    };
+    bool matched = [&]<std::size_t... I>(std::index_sequence<I...>) {
+      return (step(std::integral_constant<std::size_t, I>{}) && ...);
+    }(std::index_sequence_for<T...>{});
+    if (!matched)
+      return std::nullopt;
+    return std::make_pair(
+        std::apply([&](auto &...v) { return f(std::move(v.value())...); },
+                   values),
+        str);
+  });
+}
+
+// a parsed function applied to the value parsed after it (<*>)
+template <typename F, typename A>
+auto ap(const Parser<F> &pf, const Parser<A> &pa) {
+  return seq([](F f, A a) { return std::invoke(f, std::move(a)); }, pf, pa);
+}
+
+// both in order, keeping the value of the first (<*)
+template <typename A, typename B>
+Parser<A> seqLeft(const Parser<A> &a, const Parser<B> &b) {
+  return seq([](A x, B) { return x; }, a, b);
+}
+
+// both in order, keeping the value of the second (*>)
+template <typename A, typename B>
+Parser<B> seqRight(const Parser<A> &a, const Parser<B> &b) {
+  return seq([](A, B y) { return y; }, a, b);
+}
+
+// Commit point: once head has matched, the parse is committed to it. The
+// parsers in rest must match as well or a ParseError is thrown, and inside a
+// ParseContext no alternative starting before the commit point is tried any
+// more. Yields the same as zipMany(head, rest...).
+template <typename A, typename... T>
+auto commit(const Parser<A> &head, const Parser<T> &...rest) {
+  auto cut_after = Parser<A>([head](string_view str) {
+    auto res = head.parse(str);
+    if (res.has_value())
+      cut::mark(res.value().second);
+    return res;
+  });
+  [[maybe_unused]] auto must_match = [](auto &&parser) {
+    using R = std::decay_t<decltype(parser)>;
+    return R([parser](string_view str) {
+      auto res = parser.parse(str);
+      if (!res.has_value())
+        throw ParseError("parse failed after a commit", str);
+      return res;
+    });
+  };
+  return zipMany(cut_after, must_match(rest)...);
+}
+
+// explicit backtracking: a failure inside parser, including one past a
+// commit point, just makes attempt fail without consuming input
+template <typename T> Parser<T> attempt(const Parser<T> &parser) {
+  return Parser<T>(
+      [parser](string_view str) -> std::optional<std::pair<T, string_view>> {
+        const char *floor = cut::floor();
+        try {
+          auto res = parser.parse(str);
+          RETURN_OPT_IF_HAS_VALUE(res);
+        } catch (const ParseError &) {
+        }
+        if (cut::region != nullptr)
+          cut::region->floor = floor;
+        return std::nullopt;
+      });
+}
+
+// the same parser, with what it reads attributed to name in a heat::Heatmap
+template <typename T>
+Parser<T> named(std::string name, const Parser<T> &parser) {
+  return Parser<T>([name = std::move(name), parser](string_view str) {
+    heat::Named attribution(name);
+    return parser.parse(str);
+  });
+}
+
 template <typename... T> auto oneOf(const Parser<T> &...parsers) {
   return (... || parsers);
 }
@@ -244,6 +451,7 @@ template <typename T> Parser<bool> Optional(const Parser<T> &parser) {
     if (x.has_value()) {
       return std::make_optional(std::make_pair(true, x.value().second));
     } else {
+      cut::checkRewind(str);
       return std::make_optional(std::make_pair(false, str));
     }
   });
@@ -253,29 +461,83 @@ template <typename T> inline Parser<bool> Contains(const Parser<T> &parser) {
   return Optional(parser);
 }
 
-Parser<string_view> String(string_view prefix) {
+// the part of the input parser consumed, in place of its value
+template <typename T> Parser<string_view> recognize(const Parser<T> &parser) {
+  return Parser<string_view>(
+      [parser](string_view str)
+          -> std::optional<std::pair<string_view, string_view>> {
+        auto res = parser.parse(str);
+        RETURN_NULLOPT_IF_NO_VALUE(res);
+        string_view rest = res.value().second;
+        return std::make_pair(str.substr(0, str.size() - rest.size()), rest);
+      });
+}
+
+// the consumed input together with the value
+template <typename T>
+Parser<std::tuple<string_view, T>> matched(const Parser<T> &parser) {
+  return Parser<std::tuple<string_view, T>>(
+      [parser](string_view str)
+          -> std::optional<std::pair<std::tuple<string_view, T>, string_view>> {
+        auto res = parser.parse(str);
+        RETURN_NULLOPT_IF_NO_VALUE(res);
+        string_view rest = res.value().second;
+        return std::make_pair(
+            std::make_tuple(str.substr(0, str.size() - rest.size()),
+                            std::move(res.value().first)),
+            rest);
+      });
+}
+
+inline Parser<string_view> String(string_view prefix) {
   return Parser<string_view>(
       [prefix](string_view str)
           -> std::optional<std::pair<string_view, string_view>> {
         auto x = str.substr(0, prefix.size());
         if (x == prefix) {
+          heat::examined(str, prefix.size());
           return make_pair(prefix, str.substr(prefix.size()));
         } else {
+          // up to and including the first byte that differs
+          auto mismatch = std::mismatch(x.begin(), x.end(), prefix.begin());
+          heat::examined(str, std::min<std::size_t>(
+                                  mismatch.first - x.begin() + 1, x.size()));
           return std::nullopt;
         }
       });
 }
 
-Parser<char> Char([](string_view str) {
-  return str.empty() ? std::nullopt
-                     : std::make_optional(make_pair(str[0], str.substr(1)));
-});
+namespace primitives {
+
+inline bool any(char) { return true; }
+inline bool alpha(char c) {
+  return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+inline bool digit(char c) {
+  return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+inline bool alphaNum(char c) { return alpha(c) || digit(c); }
+inline bool whiteSpace(char c) { return c == ' ' || c == '\n' || c == '\t'; }
+template <char expected> bool is(char c) { return c == expected; }
+
+// one character satisfying pred
+template <bool (*pred)(char)>
+std::optional<std::pair<char, string_view>> charWhere(string_view str) {
+  if (str.empty() || !pred(str[0]))
+    return std::nullopt;
+  return std::make_pair(str[0], str.substr(1));
+}
+
+} // namespace primitives
+
+inline constinit const Parser<char> Char{
+    primitive(&primitives::charWhere<primitives::any>)};
 
-Parser<char> Character(char c) {
+inline Parser<char> Character(char c) {
   return Char.filter(std::bind1st(std::equal_to<char>(), c));
 }
 
-Parser<char> Characters(std::span<char> chars) {
+inline Parser<char> Characters(std::span<char> chars) {
   {
     return Char.filter([chars](char c) {
       return std::any_of(chars.begin(), chars.end(),
@@ -293,11 +555,11 @@ template <size_t N> Parser<char> Characters(const std::array<char, N> &chars) {
   }
 }
 
-Parser<char> Char_excluding(char c) {
+inline Parser<char> Char_excluding(char c) {
   return Char.filter(std::bind1st(std::not_equal_to<char>(), c));
 }
 
-Parser<char> Char_excluding_many(std::span<char> chars) {
+inline Parser<char> Char_excluding_many(std::span<char> chars) {
   return Char.filter([chars](char c) {
     return std::none_of(chars.begin(), chars.end(),
                         std::bind1st(std::equal_to<char>(), c));
@@ -312,29 +574,35 @@ Parser<char> Char_excluding_many(const std::array<char, N> &chars) {
   });
 }
 
-const Parser<char> Alpha =
-    Char.filter([](char c) { return std::isalpha(c) != 0; });
-
-const Parser<char> Digit =
-    Char.filter([](char c) { return std::isdigit(c) != 0; });
-
-const Parser<char> AlphaNum = Char.filter(
-    [](char c) { return (std::isdigit(c) != 0) || (std::isalpha(c) != 0); });
-
-const Parser<char> LeftParen = Char.filter([](char c) { return c == '('; });
-const Parser<char> RightParen = Char.filter([](char c) { return c == ')'; });
-const Parser<char> LeftCurly = Char.filter([](char c) { return c == '{'; });
-const Parser<char> RightCurly = Char.filter([](char c) { return c == '}'; });
-const Parser<char> WhiteSpace =
-    Char.filter([](char c) { return c == ' ' || c == '\n' || c == '\t'; });
-const Parser<char> Tab = Char.filter([](char c) { return c == '\t'; });
-const Parser<char> Space = Char.filter([](char c) { return c == ' '; });
-const Parser<char> NewLine = Char.filter([](char c) { return c == '\n'; });
-const Parser<bool>
-    End((Fn<std::optional<std::pair<bool, string_view>>(string_view)>)[](
-        string_view str) {
+// The primitives are constants: they are ready before any dynamic
+// initialization and are the same object in every translation unit.
+inline constinit const Parser<char> Alpha{
+    primitive(&primitives::charWhere<primitives::alpha>)};
+inline constinit const Parser<char> Digit{
+    primitive(&primitives::charWhere<primitives::digit>)};
+inline constinit const Parser<char> AlphaNum{
+    primitive(&primitives::charWhere<primitives::alphaNum>)};
+
+inline constinit const Parser<char> LeftParen{
+    primitive(&primitives::charWhere<primitives::is<'('>>)};
+inline constinit const Parser<char> RightParen{
+    primitive(&primitives::charWhere<primitives::is<')'>>)};
+inline constinit const Parser<char> LeftCurly{
+    primitive(&primitives::charWhere<primitives::is<'{'>>)};
+inline constinit const Parser<char> RightCurly{
+    primitive(&primitives::charWhere<primitives::is<'}'>>)};
+inline constinit const Parser<char> WhiteSpace{
+    primitive(&primitives::charWhere<primitives::whiteSpace>)};
+inline constinit const Parser<char> Tab{
+    primitive(&primitives::charWhere<primitives::is<'\t'>>)};
+inline constinit const Parser<char> Space{
+    primitive(&primitives::charWhere<primitives::is<' '>>)};
+inline constinit const Parser<char> NewLine{
+    primitive(&primitives::charWhere<primitives::is<'\n'>>)};
+inline constinit const Parser<bool> End{
+    [](string_view str) -> std::optional<std::pair<bool, string_view>> {
       return std::make_optional(std::make_pair(str.empty(), str));
-    });
+    }};
 
 template <typename T> Parser<T> skipPreWhitespace(const Parser<T> &p) {
   static const auto whitespace_zero_or_more = WhiteSpace.zeroOrMore();
@@ -351,33 +619,37 @@ template <typename T> Parser<T> skipSurrWhitespace(const Parser<T> &p) {
 }
 
 //
-const Parser<size_t> PosNum = Parser<size_t>(
-    ([](string_view str) -> std::optional<std::pair<int, string_view>> {
-      std::optional<std::pair<std::vector<char>, string_view>> x =
-          Digit.oneOrMore().parse(str);
-      if (!x.has_value()) {
-        return std::nullopt;
-      }
-      std::string ans;
-      for (char c : x.value().first) {
-        ans.push_back(c);
-      }
-      return std::make_optional(
-          std::make_pair(std::stoull(ans), x.value().second));
-    }));
-const Parser<long long> Num = Parser<long long>(
-    [](string_view str) -> std::optional<std::pair<long long, string_view>> {
-      auto negative_sign = Character('-').parse(str);
-      auto remaining_str =
-          negative_sign.has_value() ? negative_sign->second : str;
-      return PosNum
-          .map<long long>([&](size_t n) -> std::optional<long long> {
-            long long x = n;
-            return negative_sign.has_value() ? std::make_optional(-x)
-                                             : std::make_optional(x);
-          })
-          .parse(remaining_str);
-    });
+namespace primitives {
+
+// digits are converted in place, values that don't fit throw
+// std::out_of_range like std::stoull
+inline std::optional<std::pair<size_t, string_view>> posNum(string_view str) {
+  size_t value = 0;
+  auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  if (end == str.data())
+    return std::nullopt;
+  if (ec == std::errc::result_out_of_range)
+    throw std::out_of_range("PosNum: " +
+                            std::string(str.substr(0, end - str.data())));
+  return std::make_optional(
+      std::make_pair(value, str.substr(end - str.data())));
+}
+
+inline std::optional<std::pair<long long, string_view>> num(string_view str) {
+  bool negative = str.starts_with('-');
+  auto res = posNum(negative ? str.substr(1) : str);
+  RETURN_NULLOPT_IF_NO_VALUE(res);
+  long long x = res.value().first;
+  return std::make_optional(
+      std::make_pair(negative ? -x : x, res.value().second));
+}
+
+} // namespace primitives
+
+inline constinit const Parser<size_t> PosNum{
+    primitive(&primitives::posNum)};
+inline constinit const Parser<long long> Num{
+    primitive(&primitives::num)};
 //
 
 template <typename T> Parser<size_t> skipMany(const Parser<T> &parser) {
@@ -463,7 +735,7 @@ Parser<std::vector<A>> sepBy(const Parser<A> &separatee,
         auto first_A = separatee.parse(str);
 
         if (first_A.has_value()) {
-          final_res.push_back(first_A.value().first);
+          final_res.push_back(std::move(first_A.value().first));
           ret_str = first_A.value().second;
 
           while (true) {
@@ -478,11 +750,12 @@ Parser<std::vector<A>> sepBy(const Parser<A> &separatee,
 
             RETURN_NULLOPT_IF_NO_VALUE(next_A);
 
-            final_res.push_back(next_A.value().first);
+            final_res.push_back(std::move(next_A.value().first));
             ret_str = next_A.value().second;
           }
         }
-        return std::make_optional(std::make_pair(final_res, ret_str));
+        return std::make_optional(
+            std::make_pair(std::move(final_res), ret_str));
       });
 }
 
@@ -495,6 +768,20 @@ Parser<std::vector<A>> sepBy1(const Parser<A> &separatee,
 }
 
 } // namespace Parsers
+
+// Linking the cpparsec library target defines CPPARSEC_EXTERN_TEMPLATES, and
+// the common instantiations are then compiled once in src/cpparsec.cpp
+// instead of in every translation unit.
+#ifdef CPPARSEC_EXTERN_TEMPLATES
+extern template class Parser<char>;
+extern template class Parser<bool>;
+extern template class Parser<size_t>;
+extern template class Parser<long long>;
+extern template class Parser<string_view>;
+extern template class Parser<std::string>;
+extern template class Parser<std::vector<char>>;
+#endif
+
 } // namespace cpparsec
 
 #endif
@@ -0,0 +1,195 @@
+#ifndef ADAPTIVECHOICEHPP
+#define ADAPTIVECHOICEHPP
+
+#include "grammar.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace cpparsec {
+
+// One alternative of an AdaptiveChoice, with what is known about it. Two
+// branches commute, i.e. may be tried in either order without changing any
+// result, if one of them is marked disjoint or both have FIRST sets that
+// don't overlap.
+template <typename T> struct Branch {
+  Parser<T> parser;
+  // if set, every match is non-empty and starts with one of these bytes
+  std::optional<CharSet> first;
+  // promise that it never succeeds where another branch would
+  bool disjoint = false;
+
+  Branch(Parser<T> parser, std::optional<CharSet> first = std::nullopt,
+         bool disjoint = false)
+      : parser(std::move(parser)), first(first), disjoint(disjoint) {}
+};
+
+namespace Parsers {
+
+template <typename T>
+Branch<T> withFirst(const Parser<T> &parser, const CharSet &first) {
+  return Branch<T>(parser, first);
+}
+
+template <typename T> Branch<T> assumeDisjoint(const Parser<T> &parser) {
+  return Branch<T>(parser, std::nullopt, true);
+}
+
+// compiled rule, with its FIRST set unless the rule can match empty input
+inline Branch<string_view> branchOf(const Grammar::Rule &rule) {
+  std::optional<CharSet> first;
+  if (!Grammar::nullable(rule))
+    first = Grammar::first(rule);
+  return Branch<string_view>(Grammar::compile(rule).parser, first);
+}
+
+} // namespace Parsers
+
+// Ordered choice like oneOf, that learns which branches usually succeed and
+// moves them to the front. Only neighbouring branches that commute are ever
+// swapped, so every input gives the same result as the source order. Branches
+// with a FIRST set are also skipped without running when the next byte can't
+// start them.
+//
+// Every sample_every-th success of the choice is counted, and every
+// reorder_every samples the order is recomputed from the counts, which are
+// then halved so that the order follows a changing input. The order is a
+// single atomic word, so one instance can be shared across threads.
+template <typename T> class AdaptiveChoice {
+public:
+  static constexpr std::size_t max_branches = 16;
+
+  struct Tuning {
+    std::uint32_t sample_every = 16;
+    std::uint32_t reorder_every = 64;
+  };
+
+  explicit AdaptiveChoice(std::vector<Branch<T>> branches, Tuning tuning = {})
+      : state(std::make_shared<State>(std::move(branches), tuning)) {
+    if (state->branches.empty() || state->branches.size() > max_branches)
+      throw std::invalid_argument("AdaptiveChoice takes 1 to 16 branches");
+  }
+
+  Parser<T> parser() const {
+    return Parser<T>([state = state](string_view str) {
+      return state->parse(str);
+    });
+  }
+  operator Parser<T>() const { return parser(); }
+
+  // current order in which the branches are tried, as indices
+  std::vector<std::size_t> order() const {
+    return state->unpack(state->packed.load(std::memory_order_relaxed));
+  }
+
+  bool commutes(std::size_t a, std::size_t b) const {
+    return state->commutes(a, b);
+  }
+
+private:
+  struct State {
+    std::vector<Branch<T>> branches;
+    Tuning tuning;
+    std::atomic<std::uint64_t> packed{0}; // 4 bits per position
+    std::unique_ptr<std::atomic<std::uint64_t>[]> hits;
+    std::atomic<std::uint32_t> successes{0};
+    std::atomic<std::uint64_t> samples{0};
+    std::mutex reordering;
+
+    State(std::vector<Branch<T>> branches, Tuning tuning)
+        : branches(std::move(branches)), tuning(tuning),
+          hits(new std::atomic<std::uint64_t>[this->branches.size()]) {
+      std::vector<std::size_t> identity;
+      for (std::size_t i = 0; i < this->branches.size(); i++) {
+        identity.push_back(i);
+        hits[i] = 0;
+      }
+      packed = pack(identity);
+    }
+
+    static std::uint64_t pack(const std::vector<std::size_t> &order) {
+      std::uint64_t res = 0;
+      for (std::size_t i = 0; i < order.size(); i++)
+        res |= std::uint64_t(order[i]) << (4 * i);
+      return res;
+    }
+    std::vector<std::size_t> unpack(std::uint64_t word) const {
+      std::vector<std::size_t> order(branches.size());
+      for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = (word >> (4 * i)) & 0xf;
+      return order;
+    }
+
+    bool commutes(std::size_t a, std::size_t b) const {
+      const Branch<T> &x = branches[a], &y = branches[b];
+      return x.disjoint || y.disjoint ||
+             (x.first.has_value() && y.first.has_value() &&
+              (x.first.value() & y.first.value()).none());
+    }
+
+    std::optional<std::pair<T, string_view>> parse(string_view str) {
+      std::uint64_t word = packed.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < branches.size(); i++, word >>= 4) {
+        std::size_t index = word & 0xf;
+        const Branch<T> &branch = branches[index];
+        if (branch.first.has_value() &&
+            (str.empty() ||
+             !branch.first->test(static_cast<unsigned char>(str[0]))))
+          continue;
+        auto res = branch.parser.parse(str);
+        if (res.has_value()) {
+          sample(index);
+          return res;
+        }
+        cut::checkRewind(str);
+      }
+      return std::nullopt;
+    }
+
+    void sample(std::size_t index) {
+      if ((successes.fetch_add(1, std::memory_order_relaxed) + 1) %
+              tuning.sample_every !=
+          0)
+        return;
+      hits[index].fetch_add(1, std::memory_order_relaxed);
+      if ((samples.fetch_add(1, std::memory_order_relaxed) + 1) %
+              tuning.reorder_every ==
+          0)
+        reorder();
+    }
+
+    // bubble the hottest branches forward, one commuting swap at a time
+    void reorder() {
+      std::unique_lock<std::mutex> lock(reordering, std::try_to_lock);
+      if (!lock.owns_lock())
+        return;
+      std::vector<std::uint64_t> counts(branches.size());
+      for (std::size_t i = 0; i < counts.size(); i++)
+        counts[i] = hits[i].load(std::memory_order_relaxed);
+      std::vector<std::size_t> order =
+          unpack(packed.load(std::memory_order_relaxed));
+      for (bool swapped = true; swapped;) {
+        swapped = false;
+        for (std::size_t i = 0; i + 1 < order.size(); i++) {
+          if (counts[order[i + 1]] > counts[order[i]] &&
+              commutes(order[i], order[i + 1])) {
+            std::swap(order[i], order[i + 1]);
+            swapped = true;
+          }
+        }
+      }
+      packed.store(pack(order), std::memory_order_relaxed);
+      for (std::size_t i = 0; i < counts.size(); i++)
+        hits[i].fetch_sub(counts[i] / 2, std::memory_order_relaxed);
+    }
+  };
+
+  std::shared_ptr<State> state;
+};
+
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef ALLOCCOUNTHPP
+#define ALLOCCOUNTHPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <utility>
+
+// Counts heap allocations made on the current thread. The counting only
+// happens once global operator new is replaced (all of its plain, array,
+// nothrow and aligned forms), which is what defining
+// CPPARSEC_COUNT_ALLOCATIONS does in the one translation unit of a program
+// (a test or benchmark binary) that includes this header with it defined.
+//
+//   auto [res, usage] = alloc::measure(parser, input);
+//   usage.allocations, usage.bytes
+namespace cpparsec::alloc {
+
+struct Usage {
+  std::size_t allocations = 0;
+  std::size_t bytes = 0;
+
+  Usage operator-(const Usage &other) const {
+    return Usage{allocations - other.allocations, bytes - other.bytes};
+  }
+};
+
+// running totals of this thread, only ever increasing
+inline thread_local Usage totals{};
+inline bool hooked = false;
+
+inline void record(std::size_t bytes) {
+  totals.allocations++;
+  totals.bytes += bytes;
+}
+
+// true if operator new is counting, without it every Usage is zero
+inline bool counting() { return hooked; }
+
+template <typename F> Usage count(F &&f) {
+  Usage before = totals;
+  std::forward<F>(f)();
+  return totals - before;
+}
+
+// one top-level parse and what it allocated
+template <typename P> auto measure(const P &parser, std::string_view input) {
+  decltype(parser.parse(input)) res;
+  Usage usage = count([&] { res = parser.parse(input); });
+  return std::make_pair(std::move(res), usage);
+}
+
+} // namespace cpparsec::alloc
+
+#ifdef CPPARSEC_COUNT_ALLOCATIONS
+namespace cpparsec::alloc {
+inline const bool hook_installed = (hooked = true);
+}
+
+// out of line, so the compiler doesn't pair malloc/free with new/delete
+[[gnu::noinline]] void *operator new(std::size_t size) {
+  cpparsec::alloc::record(size);
+  if (void *p = std::malloc(size == 0 ? 1 : size))
+    return p;
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return ::operator new(size);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+void operator delete(void *p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void *p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  ::operator delete(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  ::operator delete(p);
+}
+
+// over-aligned types, aligned_alloc wants a multiple of the alignment
+[[gnu::noinline]] void *operator new(std::size_t size, std::align_val_t al) {
+  cpparsec::alloc::record(size);
+  auto align = static_cast<std::size_t>(al);
+  std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align;
+  if (void *p = std::aligned_alloc(align, rounded * align))
+    return p;
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void *operator new[](std::size_t size, std::align_val_t al) {
+  return ::operator new(size, al);
+}
+void *operator new(std::size_t size, std::align_val_t al,
+                   const std::nothrow_t &) noexcept {
+  try {
+    return ::operator new(size, al);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+void *operator new[](std::size_t size, std::align_val_t al,
+                     const std::nothrow_t &) noexcept {
+  return ::operator new(size, al, std::nothrow);
+}
+void operator delete[](void *p, std::align_val_t al) noexcept {
+  ::operator delete(p, al);
+}
+void operator delete(void *p, std::size_t, std::align_val_t al) noexcept {
+  ::operator delete(p, al);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t al) noexcept {
+  ::operator delete(p, al);
+}
+void operator delete(void *p, std::align_val_t al,
+                     const std::nothrow_t &) noexcept {
+  ::operator delete(p, al);
+}
+void operator delete[](void *p, std::align_val_t al,
+                       const std::nothrow_t &) noexcept {
+  ::operator delete(p, al);
+}
+#endif
+
+#endif
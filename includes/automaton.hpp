@@ -0,0 +1,257 @@
+#ifndef AUTOMATONHPP
+#define AUTOMATONHPP
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace cpparsec {
+
+using CharSet = std::bitset<256>;
+
+inline CharSet charSetOf(unsigned char c) {
+  CharSet set;
+  set.set(c);
+  return set;
+}
+
+template <typename Pred> CharSet charSetWhere(Pred pred) {
+  CharSet set;
+  for (int c = 0; c < 256; c++)
+    if (pred(static_cast<char>(c)))
+      set.set(c);
+  return set;
+}
+
+// Thompson NFA. Fragments have exactly one start and one accepting state and
+// are glued together with epsilon edges.
+class Nfa {
+public:
+  struct Fragment {
+    int start, accept;
+  };
+  struct State {
+    std::vector<std::pair<CharSet, int>> edges;
+    std::vector<int> eps;
+  };
+
+  std::vector<State> states;
+
+  int add_state() {
+    states.emplace_back();
+    return static_cast<int>(states.size()) - 1;
+  }
+
+  Fragment empty() {
+    int s = add_state(), a = add_state();
+    states[s].eps.push_back(a);
+    return {s, a};
+  }
+  Fragment chars(const CharSet &set) {
+    int s = add_state(), a = add_state();
+    states[s].edges.emplace_back(set, a);
+    return {s, a};
+  }
+  Fragment literal(std::string_view str) {
+    Fragment res = empty();
+    for (unsigned char c : str)
+      res = concat(res, chars(charSetOf(c)));
+    return res;
+  }
+  Fragment concat(Fragment a, Fragment b) {
+    states[a.accept].eps.push_back(b.start);
+    return {a.start, b.accept};
+  }
+  Fragment alternate(Fragment a, Fragment b) {
+    int s = add_state(), acc = add_state();
+    states[s].eps.push_back(a.start);
+    states[s].eps.push_back(b.start);
+    states[a.accept].eps.push_back(acc);
+    states[b.accept].eps.push_back(acc);
+    return {s, acc};
+  }
+  Fragment star(Fragment a) {
+    int s = add_state(), acc = add_state();
+    states[s].eps.push_back(a.start);
+    states[s].eps.push_back(acc);
+    states[a.accept].eps.push_back(a.start);
+    states[a.accept].eps.push_back(acc);
+    return {s, acc};
+  }
+  Fragment plus(Fragment a) {
+    int acc = add_state();
+    states[a.accept].eps.push_back(a.start);
+    states[a.accept].eps.push_back(acc);
+    return {a.start, acc};
+  }
+  Fragment optional(Fragment a) {
+    states[a.start].eps.push_back(a.accept);
+    return a;
+  }
+};
+
+// Minimal table-driven DFA over byte equivalence classes. Matching costs one
+// table lookup per byte and never backtracks.
+class Dfa {
+public:
+  std::array<std::uint8_t, 256> byte_class{};
+  int num_classes = 0;
+  std::vector<int> table; // state * num_classes + class -> state
+  std::vector<bool> accepting;
+  int start = 0;
+  int dead = -1; // state that can never reach an accepting state
+
+  // determinizes (subset construction) and minimizes (Moore refinement)
+  static Dfa from(const Nfa &nfa, Nfa::Fragment frag) {
+    Dfa dfa;
+    dfa.compute_byte_classes(nfa);
+
+    std::vector<unsigned char> representative(dfa.num_classes);
+    for (int c = 255; c >= 0; c--)
+      representative[dfa.byte_class[c]] = static_cast<unsigned char>(c);
+
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::vector<int>> sets;
+    auto id_of = [&](std::vector<int> set) {
+      auto [it, inserted] = ids.emplace(set, static_cast<int>(sets.size()));
+      if (inserted)
+        sets.push_back(std::move(set));
+      return it->second;
+    };
+
+    std::vector<int> table;
+    id_of(closure(nfa, {frag.start}));
+    for (std::size_t i = 0; i < sets.size(); i++) {
+      for (int k = 0; k < dfa.num_classes; k++) {
+        std::vector<int> next;
+        for (int s : sets[i])
+          for (auto &[set, to] : nfa.states[s].edges)
+            if (set.test(representative[k]))
+              next.push_back(to);
+        table.push_back(id_of(closure(nfa, std::move(next))));
+      }
+    }
+
+    std::vector<bool> accepting(sets.size());
+    for (std::size_t i = 0; i < sets.size(); i++)
+      accepting[i] = std::binary_search(sets[i].begin(), sets[i].end(),
+                                        frag.accept);
+    dfa.minimize(table, accepting);
+    return dfa;
+  }
+
+  // length of the longest accepted prefix, npos if there is none
+  std::size_t longest_match(std::string_view str) const {
+    int state = start;
+    std::size_t last = accepting[state] ? 0 : std::string_view::npos;
+    const int *row = table.data();
+    for (std::size_t i = 0; i < str.size(); i++) {
+      state = row[state * num_classes +
+                  byte_class[static_cast<unsigned char>(str[i])]];
+      if (state == dead)
+        break;
+      if (accepting[state])
+        last = i + 1;
+    }
+    return last;
+  }
+
+  std::size_t size() const { return accepting.size(); }
+
+private:
+  static std::vector<int> closure(const Nfa &nfa, std::vector<int> states) {
+    std::vector<bool> seen(nfa.states.size());
+    std::vector<int> todo;
+    for (int s : states)
+      if (!seen[s]) {
+        seen[s] = true;
+        todo.push_back(s);
+      }
+    states.clear();
+    while (!todo.empty()) {
+      int s = todo.back();
+      todo.pop_back();
+      states.push_back(s);
+      for (int t : nfa.states[s].eps)
+        if (!seen[t]) {
+          seen[t] = true;
+          todo.push_back(t);
+        }
+    }
+    std::sort(states.begin(), states.end());
+    return states;
+  }
+
+  // bytes that every edge treats the same way share a class
+  void compute_byte_classes(const Nfa &nfa) {
+    std::map<std::vector<bool>, int> signatures;
+    for (int c = 0; c < 256; c++) {
+      std::vector<bool> sig;
+      for (auto &state : nfa.states)
+        for (auto &edge : state.edges)
+          sig.push_back(edge.first.test(c));
+      auto [it, _] = signatures.emplace(std::move(sig),
+                                        static_cast<int>(signatures.size()));
+      byte_class[c] = static_cast<std::uint8_t>(it->second);
+    }
+    num_classes = static_cast<int>(signatures.size());
+  }
+
+  void minimize(const std::vector<int> &full_table,
+                const std::vector<bool> &full_accepting) {
+    std::size_t n = full_accepting.size();
+    std::vector<int> block(n);
+    for (std::size_t i = 0; i < n; i++)
+      block[i] = full_accepting[i] ? 1 : 0;
+
+    int num_blocks = 0;
+    while (true) {
+      std::map<std::vector<int>, int> signatures;
+      std::vector<int> next(n);
+      for (std::size_t i = 0; i < n; i++) {
+        std::vector<int> sig{block[i]};
+        for (int k = 0; k < num_classes; k++)
+          sig.push_back(block[full_table[i * num_classes + k]]);
+        auto [it, _] = signatures.emplace(std::move(sig),
+                                          static_cast<int>(signatures.size()));
+        next[i] = it->second;
+      }
+      bool stable = static_cast<int>(signatures.size()) == num_blocks;
+      num_blocks = static_cast<int>(signatures.size());
+      block = std::move(next);
+      if (stable)
+        break;
+    }
+
+    table.assign(num_blocks * num_classes, 0);
+    accepting.assign(num_blocks, false);
+    for (std::size_t i = 0; i < n; i++) {
+      accepting[block[i]] = full_accepting[i];
+      for (int k = 0; k < num_classes; k++)
+        table[block[i] * num_classes + k] =
+            block[full_table[i * num_classes + k]];
+    }
+    start = block[0];
+
+    // the dead state loops to itself on every class and never accepts
+    dead = -1;
+    for (int b = 0; b < num_blocks && dead < 0; b++) {
+      if (accepting[b])
+        continue;
+      bool loops = true;
+      for (int k = 0; k < num_classes && loops; k++)
+        loops = table[b * num_classes + k] == b;
+      if (loops)
+        dead = b;
+    }
+  }
+};
+
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef BUDGETHPP
+#define BUDGETHPP
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+
+namespace cpparsec {
+
+// how a ParseContext::run ended
+enum class ParseStatus { Ok, NoMatch, StepLimit, DepthLimit, Deadline };
+
+// Resource limits for one ParseContext::run, 0 meaning unlimited. A step is
+// one call of any parser (and one step of the operator search of
+// buildExpr), depth is how many of those calls are nested.
+struct Budget {
+  std::size_t max_steps = 0;
+  std::size_t max_depth = 0;
+  std::optional<std::chrono::nanoseconds> max_time;
+};
+
+// Thrown when a budget runs out. Unlike ParseError no combinator catches it,
+// ParseContext::run turns it into its status.
+struct BudgetExceeded : std::runtime_error {
+  ParseStatus status;
+  explicit BudgetExceeded(ParseStatus status)
+      : std::runtime_error("parse budget exceeded"), status(status) {}
+};
+
+// Bookkeeping for budgets. While a ParseContext with a budget runs, meter
+// points at its counters, outside of one nothing is counted and the cost
+// of a parser call is a thread_local load and a branch.
+namespace budget {
+
+using Clock = std::chrono::steady_clock;
+// the clock is read once per this many steps
+inline constexpr std::size_t clock_every = 1024;
+
+struct Meter {
+  Budget limits;
+  Clock::time_point deadline;
+  std::size_t steps = 0, depth = 0;
+
+  void enter() {
+    if (limits.max_steps != 0 && steps >= limits.max_steps)
+      throw BudgetExceeded(ParseStatus::StepLimit);
+    steps++;
+    if (limits.max_depth != 0 && depth >= limits.max_depth)
+      throw BudgetExceeded(ParseStatus::DepthLimit);
+    if (limits.max_time.has_value() && steps % clock_every == 0 &&
+        Clock::now() >= deadline)
+      throw BudgetExceeded(ParseStatus::Deadline);
+    depth++;
+  }
+
+  // Budget for work another thread does as part of this run: the same
+  // limits and deadline from the current depth, with the steps left.
+  Meter fork() const {
+    if (limits.max_steps != 0 && steps >= limits.max_steps)
+      throw BudgetExceeded(ParseStatus::StepLimit); // 0 would mean unlimited
+    Meter sub = *this;
+    sub.steps = 0;
+    if (limits.max_steps != 0)
+      sub.limits.max_steps = limits.max_steps - steps;
+    return sub;
+  }
+  // adds the steps of a forked meter, which may together exceed the limit
+  void merge(const Meter &sub) {
+    steps += sub.steps;
+    if (limits.max_steps != 0 && steps > limits.max_steps)
+      throw BudgetExceeded(ParseStatus::StepLimit);
+  }
+};
+
+inline thread_local Meter *meter = nullptr;
+
+// counts one nested call for as long as it lives
+class Guard {
+public:
+  Guard() : counted(meter) {
+    if (counted != nullptr) [[unlikely]]
+      counted->enter();
+  }
+  ~Guard() {
+    if (counted != nullptr) [[unlikely]]
+      counted->depth--;
+  }
+  Guard(const Guard &) = delete;
+  Guard &operator=(const Guard &) = delete;
+
+private:
+  Meter *counted;
+};
+
+} // namespace budget
+} // namespace cpparsec
+
+#endif
@@ -8,6 +8,8 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
+#include <unordered_map>
 #include <variant>
 
 using namespace std::placeholders;
@@ -15,16 +17,69 @@ using namespace std::placeholders;
 using namespace cpparsec;
 using namespace cpparsec::Parsers;
 
-template <typename T>
-std::optional<std::pair<Expr<T>, string_view>>
-buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
-          string_view str) {
+// Builds Expr<T> trees. buildExprWith is generic over the node builder so
+// other representations (see hashConsExpr.hpp) can reuse the same operator
+// search. A builder provides node_type, leaf, prefix, postfix, infix and
+// rotate. rotate returns the rebalanced node when the right operand is an
+// infix operation with the same name, std::nullopt otherwise.
+template <typename T> struct ExprBuilder {
+  using node_type = Expr<T>;
+
+  node_type leaf(T val) { return Expr<T>(std::move(val)); }
+  node_type prefix(const std::string &op_name, node_type x) {
+    return Expr<T>(PrefixOperation<T>(op_name, std::move(x)));
+  }
+  node_type postfix(const std::string &op_name, node_type x) {
+    return Expr<T>(PostfixOperation<T>(op_name, std::move(x)));
+  }
+  node_type infix(const std::string &op_name, node_type lhs, node_type rhs) {
+    return Expr<T>(InfixOperation<T>(op_name, std::move(lhs), std::move(rhs)));
+  }
+  std::optional<node_type> rotate(const std::string &op_name, node_type &left,
+                                  node_type &right) {
+    if (op_name != std::visit(get_op_name_of_Expr, right.tree))
+      return std::nullopt;
+    InfixOperation<T> right_infix_op =
+        std::visit(get_lhs_rhs_out_of_Infix, right.tree);
+    InfixOperation<T> rights_left;
+    rights_left.type = op_name;
+    rights_left.lhs = std::make_unique<Expr<T>>(std::move(left));
+    rights_left.rhs = std::move(right_infix_op.lhs);
+    right_infix_op.lhs =
+        std::make_unique<Expr<T>>(Expr<T>(std::move(rights_left)));
+    return std::make_optional<node_type>(Expr<T>(std::move(right_infix_op)));
+  }
+};
 
+// A builder can also remember results: every call's result only depends on
+// the table suffix (identified by its size) and the text of str, so if it
+// provides recall(level, str) and remember(level, str, result), buildExprWith
+// asks it before searching and tells it every result (failures included).
+// See incrementalExpr.hpp.
+template <typename Builder>
+concept RecallingBuilder = requires(
+    Builder &builder, std::size_t level, string_view str,
+    const std::optional<std::pair<typename Builder::node_type, string_view>>
+        &res) {
+  { builder.recall(level, str) };
+  builder.remember(level, str, res);
+};
+
+template <typename T, typename Builder>
+std::optional<std::pair<typename Builder::node_type, string_view>>
+buildExprWith(std::span<ExprType> table, const Parser<T> &base_parser,
+              string_view str, Builder &builder);
+
+template <typename T, typename Builder>
+std::optional<std::pair<typename Builder::node_type, string_view>>
+buildExprSearch(std::span<ExprType> table, const Parser<T> &base_parser,
+                string_view str, Builder &builder) {
+  using Node = typename Builder::node_type;
   unsigned iter_count = 1;
   for (auto &x : table) {
     TypeDescription descr = std::visit(visit_for_ExprTypeDescription, x);
     auto result(std::visit(
-        [&](const auto &type) -> std::optional<pair<Expr<T>, string_view>> {
+        [&](const auto &type) -> std::optional<pair<Node, string_view>> {
           using V = std::decay_t<decltype(type)>;
           // poor man's pattern matching
           if constexpr (std::is_same_v<V, PREFIX>) { // IF THE TYPE IS PREFIX
@@ -32,13 +87,13 @@ buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
             auto has_operator = str.starts_with(op);
             if (!has_operator)
               return std::nullopt;
-            auto res = buildExpr(table, base_parser, str.substr(op.size()));
+            auto res = buildExprWith(table, base_parser,
+                                     str.substr(op.size()), builder);
 
             RETURN_NULLOPT_IF_NO_VALUE(res);
 
-            return std::make_optional<std::pair<Expr<T>, string_view>>(
-                {Expr<T>(PrefixOperation<T>(descr.op_name,
-                                            std::move(res.value().first))),
+            return std::make_optional<std::pair<Node, string_view>>(
+                {builder.prefix(descr.op_name, std::move(res.value().first)),
                  res.value().second});
 
           } else if constexpr (std::is_same_v<V, POSTFIX>) { // IF THE TYPE IS
@@ -48,39 +103,38 @@ buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
             auto has_operator = str.ends_with(descr.op);
             if (!has_operator)
               return std::nullopt;
-            auto res =
-                buildExpr(table.last(table.size() - iter_count), base_parser,
-                          str.substr(0, str.size() - descr.op.size()));
+            auto res = buildExprWith(
+                table.last(table.size() - iter_count), base_parser,
+                str.substr(0, str.size() - descr.op.size()), builder);
 
             RETURN_NULLOPT_IF_NO_VALUE(res);
 
-            return std::make_optional<std::pair<Expr<T>, string_view>>(
-                {PostfixOperation<T>(descr.op_name,
-                                     std::move(res.value().first)),
+            return std::make_optional<std::pair<Node, string_view>>(
+                {builder.postfix(descr.op_name, std::move(res.value().first)),
                  res.value().second});
 
           } else { // FOR INFIX TYPES
             string_view new_str = str;
             while (true) {
               auto it = new_str.find(descr.op);
-              auto string_parser = String(descr.op);
               if (it == std::string::npos)
                 break;
               // remove all the elements before the matched part
               new_str.remove_prefix(it);
-              auto res = string_parser.parse(new_str);
+              // find matched the operator, the right operand follows it
+              string_view after_op = new_str.substr(descr.op.size());
               auto left_sub_str = str.substr(0, str.size() - new_str.size());
-              std::optional<pair<Expr<T>, string_view>> left_op(
-                  buildExpr(table.last(table.size() - iter_count), base_parser,
-                            left_sub_str));
+              std::optional<pair<Node, string_view>> left_op(
+                  buildExprWith(table.last(table.size() - iter_count),
+                                base_parser, left_sub_str, builder));
               /// if no valid thing in left parse, ignore and move on
               if (!left_op.has_value() || left_op.value().second != "") {
                 new_str.remove_prefix(1);
                 continue;
               }
 
-              std::optional<pair<Expr<T>, string_view>> right_op(
-                  buildExpr(table, base_parser, res.value().second));
+              std::optional<pair<Node, string_view>> right_op(
+                  buildExprWith(table, base_parser, after_op, builder));
 
               // ignore the last parse and move on
               if (!right_op.has_value()) {
@@ -91,27 +145,18 @@ buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
               // if say we have + currently and the right operand is also a tree
               // with
               // + at the top ,then we bring associativity into play
-              if (descr.op_name == std::visit(get_op_name_of_Expr,
-                                              right_op.value().first.tree)) {
-                if (descr.associativity == Assoc::Left) {
-                  InfixOperation<T> right_infix_op = std::visit(
-                      get_lhs_rhs_out_of_Infix, right_op.value().first.tree);
-                  InfixOperation<T> rights_left;
-                  rights_left.type = descr.op_name;
-                  rights_left.lhs = std::make_unique<Expr<T>>(
-                      std::move(left_op.value().first));
-                  rights_left.rhs = std::move(right_infix_op.lhs);
-                  right_infix_op.lhs = std::make_unique<Expr<T>>(
-                      Expr<T>(std::move(rights_left)));
-                  return std::make_optional<std::pair<Expr<T>, string_view>>(
-                      {Expr<T>(std::move(right_infix_op)),
-                       right_op.value().second});
-                }
+              if (descr.associativity == Assoc::Left) {
+                auto rotated =
+                    builder.rotate(descr.op_name, left_op.value().first,
+                                   right_op.value().first);
+                if (rotated.has_value())
+                  return std::make_optional<std::pair<Node, string_view>>(
+                      {std::move(rotated.value()), right_op.value().second});
               }
-              return std::make_optional<std::pair<Expr<T>, string_view>>(
-                  {Expr<T>(InfixOperation<T>(
-                       descr.op_name, std::move(left_op.value().first),
-                       std::move(right_op.value().first))),
+              return std::make_optional<std::pair<Node, string_view>>(
+                  {builder.infix(descr.op_name,
+                                 std::move(left_op.value().first),
+                                 std::move(right_op.value().first)),
                    right_op.value().second});
             }
             return std::nullopt;
@@ -125,11 +170,40 @@ buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
 
   auto base_parse_res = base_parser.parse(str);
   RETURN_NULLOPT_IF_NO_VALUE(base_parse_res);
-  return std::make_optional<std::pair<Expr<T>, string_view>>(
-      {Expr<T>(T(base_parser.parse(str).value().first)),
+  return std::make_optional<std::pair<Node, string_view>>(
+      {builder.leaf(T(std::move(base_parse_res.value().first))),
        base_parse_res.value().second});
 }
 
+template <typename T, typename Builder>
+std::optional<std::pair<typename Builder::node_type, string_view>>
+buildExprWith(std::span<ExprType> table, const Parser<T> &base_parser,
+              string_view str, Builder &builder) {
+  // recursion depth follows the input, continue on the heap when needed
+  if (stack::nearlyExhausted())
+    return growStack(
+        [&] { return buildExprWith(table, base_parser, str, builder); });
+  budget::Guard guard;
+
+  if constexpr (RecallingBuilder<Builder>) {
+    if (auto hit = builder.recall(table.size(), str))
+      return std::move(hit.value());
+    auto res = buildExprSearch(table, base_parser, str, builder);
+    builder.remember(table.size(), str, res);
+    return res;
+  } else {
+    return buildExprSearch(table, base_parser, str, builder);
+  }
+}
+
+template <typename T>
+std::optional<std::pair<Expr<T>, string_view>>
+buildExpr(std::span<ExprType> table, const Parser<T> &base_parser,
+          string_view str) {
+  ExprBuilder<T> builder;
+  return buildExprWith(table, base_parser, str, builder);
+}
+
 template <typename T>
 Parser<Expr<T>> buildExpressionParser(std::span<ExprType> table,
                                       const Parser<T> &base_parser) {
@@ -138,4 +212,93 @@ Parser<Expr<T>> buildExpressionParser(std::span<ExprType> table,
       [=](string_view str) { return buildExpr(table, base_parser, str); }));
 }
 
+// Semantic actions for evaluating while parsing: leaf turns a value of the
+// base parser into an R, and every operator of the table, by its op_name,
+// has an action in unary (PREFIX and POSTFIX) or binary (INFIX). The
+// search backtracks, so actions also run for parses that are thrown away
+// later and must not have side effects.
+template <typename T, typename R> struct ExprActions {
+  std::function<R(T)> leaf;
+  std::unordered_map<std::string, std::function<R(R)>> unary;
+  std::unordered_map<std::string, std::function<R(R, R)>> binary;
+};
+
+// Builder for buildExprWith that applies ExprActions as operators are
+// reduced. A node is the value so far, plus the operands of its infix
+// action so that rotate can regroup them like ExprBuilder regroups trees.
+template <typename T, typename R> struct ActionBuilder {
+  using Binary = std::function<R(R, R)>;
+  struct node_type {
+    R value;
+    const Binary *top = nullptr;
+    std::optional<R> lhs, rhs;
+  };
+
+  const ExprActions<T, R> &actions;
+
+  static node_type value(R val) {
+    return node_type{std::move(val), nullptr, std::nullopt, std::nullopt};
+  }
+  node_type leaf(T val) { return value(actions.leaf(std::move(val))); }
+  node_type prefix(const std::string &op_name, node_type x) {
+    return value(actions.unary.at(op_name)(std::move(x.value)));
+  }
+  node_type postfix(const std::string &op_name, node_type x) {
+    return value(actions.unary.at(op_name)(std::move(x.value)));
+  }
+  node_type infix(const std::string &op_name, node_type lhs, node_type rhs) {
+    const Binary &f = actions.binary.at(op_name);
+    R value = f(lhs.value, rhs.value);
+    return node_type{std::move(value), &f, std::move(lhs.value),
+                     std::move(rhs.value)};
+  }
+  std::optional<node_type> rotate(const std::string &op_name, node_type &left,
+                                  node_type &right) {
+    const Binary &f = actions.binary.at(op_name);
+    if (right.top != &f)
+      return std::nullopt;
+    R rights_left = f(std::move(left.value), std::move(right.lhs.value()));
+    R value = f(rights_left, right.rhs.value());
+    return node_type{std::move(value), &f, std::move(rights_left),
+                     std::move(right.rhs.value())};
+  }
+};
+
+// Like buildExpressionParser, but gives the value computed by actions
+// instead of a tree. Throws std::invalid_argument if an operator of the
+// table has no action.
+template <typename T, typename R>
+Parser<R> buildExpressionParser(std::span<ExprType> table,
+                                const Parser<T> &base_parser,
+                                ExprActions<T, R> actions) {
+  for (const auto &x : table) {
+    TypeDescription descr = std::visit(visit_for_ExprTypeDescription, x);
+    bool found = std::holds_alternative<INFIX>(x)
+                     ? actions.binary.contains(descr.op_name)
+                     : actions.unary.contains(descr.op_name);
+    if (!found)
+      throw std::invalid_argument("no action for operator " + descr.op_name);
+  }
+  return Parser<R>([=](string_view str) -> std::optional<pair<R, string_view>> {
+    ActionBuilder<T, R> builder{actions};
+    auto res = buildExprWith(table, base_parser, str, builder);
+    RETURN_NULLOPT_IF_NO_VALUE(res);
+    return std::make_pair(std::move(res.value().first.value),
+                          res.value().second);
+  });
+}
+
+#ifdef CPPARSEC_EXTERN_TEMPLATES
+extern template struct Expr<char>;
+extern template struct Expr<std::string>;
+extern template std::optional<std::pair<Expr<char>, string_view>>
+buildExpr(std::span<ExprType>, const Parser<char> &, string_view);
+extern template std::optional<std::pair<Expr<std::string>, string_view>>
+buildExpr(std::span<ExprType>, const Parser<std::string> &, string_view);
+extern template Parser<Expr<char>>
+buildExpressionParser(std::span<ExprType>, const Parser<char> &);
+extern template Parser<Expr<std::string>>
+buildExpressionParser(std::span<ExprType>, const Parser<std::string> &);
+#endif
+
 #endif
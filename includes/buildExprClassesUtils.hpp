@@ -5,6 +5,7 @@
 #include <memory>
 #include <string>
 #include <variant>
+#include <vector>
 
 template <typename T> struct Expr;
 
@@ -49,6 +50,7 @@ template <typename T> struct Expr {
   template <typename U> Expr(U t) : tree(std::move(t)) {}
   Expr(Expr &&e);
   Expr &operator=(Expr &&e);
+  ~Expr();
 };
 
 template <typename T>
@@ -107,6 +109,35 @@ template <typename T> Expr<T> &Expr<T>::operator=(Expr<T> &&e) {
   return *this;
 }
 
+// children are unlinked onto an explicit stack first, so destroying a deeply
+// nested tree doesn't recurse once per level
+template <typename T> Expr<T>::~Expr() {
+  std::vector<std::unique_ptr<Expr<T>>> pending;
+  auto unlink = [&pending](Expr<T> &e) {
+    std::visit(
+        [&pending](auto &x) {
+          using U = std::decay_t<decltype(x)>;
+          if constexpr (std::is_same_v<U, InfixOperation<T>>) {
+            if (x.lhs)
+              pending.push_back(std::move(x.lhs));
+            if (x.rhs)
+              pending.push_back(std::move(x.rhs));
+          } else if constexpr (std::is_same_v<U, PrefixOperation<T>> ||
+                               std::is_same_v<U, PostfixOperation<T>>) {
+            if (x.a)
+              pending.push_back(std::move(x.a));
+          }
+        },
+        e.tree);
+  };
+  unlink(*this);
+  while (!pending.empty()) {
+    auto e = std::move(pending.back());
+    pending.pop_back();
+    unlink(*e);
+  }
+}
+
 enum class Assoc { Left, Right };
 
 struct TypeDescription {
@@ -132,7 +163,7 @@ struct POSTFIX : TypeDescription {
 
 using ExprType = std::variant<PREFIX, INFIX, POSTFIX>;
 
-[[maybe_unused]] auto visit_for_ExprTypeDescription =
+[[maybe_unused]] inline constexpr auto visit_for_ExprTypeDescription =
     [](const auto &x) -> TypeDescription {
   using T = std::decay_t<decltype(x)>;
   if constexpr (std::is_same_v<T, PREFIX>) {
@@ -150,7 +181,7 @@ template <typename T> struct T_of_Expr<PrefixOperation<T>> { using type = T; };
 template <typename T> struct T_of_Expr<PostfixOperation<T>> { using type = T; };
 
 // used by Expr<T>::tree
-[[maybe_unused]] auto get_op_name_of_Expr =
+[[maybe_unused]] inline constexpr auto get_op_name_of_Expr =
     [](const auto &x) -> std::string_view {
   using T = std::decay_t<decltype(x)>;
   using V = typename T_of_Expr<T>::type;
@@ -166,7 +197,7 @@ template <typename T> struct T_of_Expr<PostfixOperation<T>> { using type = T; };
 };
 
 // used by Expr<T>::tree
-[[maybe_unused]] auto get_lhs_rhs_out_of_Infix = [](auto &&x) {
+[[maybe_unused]] inline constexpr auto get_lhs_rhs_out_of_Infix = [](auto &&x) {
   using T = std::decay_t<decltype(x)>;
   using V = typename T_of_Expr<T>::type;
 
@@ -0,0 +1,205 @@
+#ifndef CONTEXTHPP
+#define CONTEXTHPP
+
+#include "Parser.hpp"
+#include "memory.hpp"
+
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+
+namespace cpparsec {
+
+// Constructed parsers are immutable and can be shared by any number of
+// threads. Whatever a parse needs to mutate (memo tables, arenas, symbol
+// tables) lives in a ParseContext instead, one per call or per thread.
+//
+//   ParseContext ctx;
+//   auto res = ctx.run(grammar, input);
+//
+// While run() executes, ParseContext::current() on that thread returns ctx.
+class ParseContext {
+public:
+  ParseContext() = default;
+  ParseContext(const ParseContext &) = delete;
+  ParseContext &operator=(const ParseContext &) = delete;
+
+  // Runs parser over input. A budget that runs out makes the run fail with
+  // the status saying which one it was.
+  template <typename T>
+  std::optional<std::pair<T, string_view>> run(const Parser<T> &parser,
+                                               string_view input) {
+    Scope scope(*this, input);
+    try {
+      auto res = parser.parse(input);
+      last_status = res.has_value() ? ParseStatus::Ok : ParseStatus::NoMatch;
+      return res;
+    } catch (const BudgetExceeded &e) {
+      last_status = e.status;
+      return std::nullopt;
+    }
+  }
+
+  // limits for every following run(), Budget{} removes them
+  void setBudget(const Budget &budget) { limits = budget; }
+  // outcome of the last run()
+  ParseStatus status() const { return last_status; }
+  // steps the last run() took, only counted with a budget set
+  std::size_t steps() const { return meter.steps; }
+
+  // what memory::resource() returns during every following run(), nullptr
+  // to keep the one of the enclosing run (or the default resource)
+  void setMemoryResource(std::pmr::memory_resource *resource) {
+    arena = resource;
+  }
+  std::pmr::memory_resource *memoryResource() const { return arena; }
+
+  // counts the bytes every following run() reads, see heatmap.hpp. Each
+  // run starts the heatmap over on its input, nullptr stops recording.
+  void setHeatmap(heat::Heatmap *map) { heatmap = map; }
+
+  // counts outermost run()s, a nested run() on this context is part of the
+  // one around it. Per-run state compares it to forget earlier runs.
+  std::size_t generation() const { return generation_; }
+
+  // context of the innermost run() on this thread, if any
+  static ParseContext *current() { return current_context; }
+
+  string_view input() const { return whole_input; }
+  // position of the remaining input inside the input of run()
+  std::size_t offset(string_view rest) const {
+    return static_cast<std::size_t>(rest.data() - whole_input.data());
+  }
+  // offset of the furthest commit point the running parse passed, the input
+  // before it won't be looked at again
+  std::size_t committed() const {
+    return cuts.floor == nullptr ? 0 : offset(string_view(cuts.floor, 0));
+  }
+
+  // per-context instance of S, default constructed on first use
+  template <typename S> S &state() {
+    auto &slot = states[std::type_index(typeid(S))];
+    if (!slot)
+      slot = std::make_shared<S>();
+    return *static_cast<S *>(slot.get());
+  }
+
+  void clear() { states.clear(); }
+
+private:
+  struct Scope {
+    ParseContext &ctx;
+    ParseContext *outer;
+    string_view outer_input;
+    cut::Region outer_cuts;
+    cut::Region *outer_region;
+    budget::Meter *outer_meter;
+    std::pmr::memory_resource *outer_memory;
+    heat::Heatmap *outer_heatmap;
+    Scope(ParseContext &ctx, string_view input)
+        : ctx(ctx), outer(current_context), outer_input(ctx.whole_input),
+          outer_cuts(ctx.cuts), outer_region(cut::region),
+          outer_meter(budget::meter), outer_memory(memory::current),
+          outer_heatmap(heat::recorder) {
+      if (ctx.active_runs++ == 0)
+        ctx.generation_++;
+      ctx.whole_input = input;
+      ctx.cuts = cut::Region();
+      current_context = &ctx;
+      cut::region = &ctx.cuts;
+      if (ctx.arena != nullptr)
+        memory::current = ctx.arena;
+      if (ctx.heatmap != nullptr && ctx.heatmap != outer_heatmap) {
+        ctx.heatmap->reset(input);
+        heat::recorder = ctx.heatmap;
+      }
+      // a run nested in one of the same context shares its budget
+      if (outer_meter == &ctx.meter)
+        return;
+      ctx.meter = budget::Meter();
+      ctx.meter.limits = ctx.limits;
+      if (ctx.limits.max_time.has_value())
+        ctx.meter.deadline = budget::Clock::now() + *ctx.limits.max_time;
+      bool limited = ctx.limits.max_steps != 0 || ctx.limits.max_depth != 0 ||
+                     ctx.limits.max_time.has_value();
+      budget::meter = limited ? &ctx.meter : nullptr;
+    }
+    ~Scope() {
+      ctx.active_runs--;
+      ctx.whole_input = outer_input;
+      ctx.cuts = outer_cuts;
+      current_context = outer;
+      cut::region = outer_region;
+      budget::meter = outer_meter;
+      memory::current = outer_memory;
+      heat::recorder = outer_heatmap;
+    }
+  };
+
+  string_view whole_input;
+  cut::Region cuts;
+  Budget limits;
+  budget::Meter meter;
+  std::pmr::memory_resource *arena = nullptr;
+  heat::Heatmap *heatmap = nullptr;
+  std::size_t generation_ = 0;
+  std::size_t active_runs = 0;
+  ParseStatus last_status = ParseStatus::Ok;
+  std::unordered_map<std::type_index, std::shared_ptr<void>> states;
+  inline static thread_local ParseContext *current_context = nullptr;
+};
+
+namespace Parsers {
+
+// Packrat memoization: results are cached per input position in the current
+// ParseContext for one run(), so the parser itself stays immutable. Entries
+// before the last commit point are dropped. Without a context it just runs
+// the parser.
+template <typename T> Parser<T> memoize(const Parser<T> &parser) {
+  using Result = std::optional<std::pair<T, string_view>>;
+  using Key = std::tuple<const void *, const char *, std::size_t>;
+  struct KeyHash {
+    std::size_t operator()(const Key &k) const {
+      return std::hash<const void *>{}(std::get<0>(k)) ^
+             (std::hash<const char *>{}(std::get<1>(k)) << 1) ^
+             (std::get<2>(k) << 3);
+    }
+  };
+  struct Table {
+    std::unordered_map<Key, Result, KeyHash> entries;
+    const char *pruned = nullptr; // commit point at the last pruning
+    std::size_t generation = 0;   // run the entries belong to
+  };
+
+  auto id = std::make_shared<const char>(0); // identifies this parser
+  return Parser<T>([parser, id](string_view str) -> Result {
+    ParseContext *ctx = ParseContext::current();
+    if (ctx == nullptr)
+      return parser.parse(str);
+    Key key(id.get(), str.data(), str.size());
+    auto &table = ctx->state<Table>();
+    // entries are keyed by address, which a later input can reuse
+    if (table.generation != ctx->generation()) {
+      table.entries.clear();
+      table.pruned = nullptr;
+      table.generation = ctx->generation();
+    }
+    if (const char *floor = cut::floor(); floor != table.pruned) {
+      std::erase_if(table.entries, [floor](const auto &entry) {
+        return std::less<const char *>{}(std::get<1>(entry.first), floor);
+      });
+      table.pruned = floor;
+    }
+    auto it = table.entries.find(key);
+    if (it != table.entries.end())
+      return it->second;
+    Result res = parser.parse(str);
+    table.entries.emplace(key, res);
+    return res;
+  });
+}
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CUTHPP
+#define CUTHPP
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace cpparsec {
+
+// Thrown when a parse fails past a commit point, where backtracking to an
+// alternative is no longer allowed. rest is the input left at the failure.
+struct ParseError : std::runtime_error {
+  std::string_view rest;
+  ParseError(const std::string &what, std::string_view rest)
+      : std::runtime_error(what), rest(rest) {}
+};
+
+// Bookkeeping for commit points (Parsers::commit). While a ParseContext runs
+// a parser, region covers its input and floor is the furthest point the
+// parse committed to: nothing before it is looked at again, so combinators
+// that would resume before it throw instead, and memo entries before it can
+// be dropped. Outside of a ParseContext nothing is recorded.
+namespace cut {
+
+struct Region {
+  const char *floor = nullptr;
+};
+
+inline thread_local Region *region = nullptr;
+
+inline void mark(std::string_view rest) {
+  if (region != nullptr && std::less<const char *>{}(region->floor, rest.data()))
+    region->floor = rest.data();
+}
+
+inline const char *floor() {
+  return region == nullptr ? nullptr : region->floor;
+}
+
+// called by combinators before they resume at str after a failed attempt
+inline void checkRewind(std::string_view str) {
+  if (region != nullptr && region->floor != nullptr &&
+      std::less<const char *>{}(str.data(), region->floor))
+    throw ParseError("parse failed after a commit", str);
+}
+
+} // namespace cut
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef EXPRSERIALIZEHPP
+#define EXPRSERIALIZEHPP
+
+#include "buildExprClassesUtils.hpp"
+#include "stackSafe.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CPPARSEC_HAS_MMAP 1
+#endif
+
+// Binary encoding of Expr<T>, so a parsed tree can be cached on disk and
+// read back without parsing. Layout (integers little endian):
+//
+//   "CPEX" u8 version, 3 zero bytes
+//   u32 string count n, u32 string bytes, u32 node bytes
+//   u32 offsets[n + 1] into the string bytes
+//   string bytes: operator names and encoded leaves, each stored once
+//   node bytes, pre-order from the root, one node each:
+//     u8 opcode, varint string index,
+//     infix only: varint byte length of the lhs subtree (to skip to the rhs)
+//
+// ExprView walks the bytes in place, e.g. straight out of a MappedFile.
+
+inline constexpr std::uint8_t expr_format_version = 1;
+
+enum class ExprOp : std::uint8_t { Leaf, Prefix, Postfix, Infix };
+
+// How leaves are turned into bytes for the string table. Specialize it for
+// other leaf types.
+template <typename T, typename = void> struct LeafCodec;
+
+template <> struct LeafCodec<std::string> {
+  static void encode(const std::string &leaf, std::string &out) { out += leaf; }
+  static std::string decode(std::string_view bytes) {
+    return std::string(bytes);
+  }
+};
+
+template <typename T>
+struct LeafCodec<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+  static void encode(T leaf, std::string &out) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &leaf, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big)
+      std::reverse(bytes, bytes + sizeof(T));
+    out.append(reinterpret_cast<const char *>(bytes), sizeof(T));
+  }
+  static T decode(std::string_view bytes) {
+    if (bytes.size() != sizeof(T))
+      throw std::runtime_error("bad leaf size in serialized Expr");
+    unsigned char raw[sizeof(T)];
+    std::memcpy(raw, bytes.data(), sizeof(T));
+    if constexpr (std::endian::native == std::endian::big)
+      std::reverse(raw, raw + sizeof(T));
+    T leaf;
+    std::memcpy(&leaf, raw, sizeof(T));
+    return leaf;
+  }
+};
+
+// alternative index followed by the alternative's encoding
+template <typename... Ts> struct LeafCodec<std::variant<Ts...>> {
+  static void encode(const std::variant<Ts...> &leaf, std::string &out) {
+    out.push_back(static_cast<char>(leaf.index()));
+    std::visit(
+        [&out](const auto &x) {
+          LeafCodec<std::decay_t<decltype(x)>>::encode(x, out);
+        },
+        leaf);
+  }
+  static std::variant<Ts...> decode(std::string_view bytes) {
+    if (bytes.empty() || static_cast<std::size_t>(bytes[0]) >= sizeof...(Ts))
+      throw std::runtime_error("bad variant leaf in serialized Expr");
+    return decodeAt(static_cast<std::size_t>(bytes[0]), bytes.substr(1),
+                    std::index_sequence_for<Ts...>());
+  }
+
+private:
+  template <std::size_t... I>
+  static std::variant<Ts...> decodeAt(std::size_t index, std::string_view bytes,
+                                      std::index_sequence<I...>) {
+    std::variant<Ts...> res;
+    ((index == I ? (res.template emplace<I>(
+                        LeafCodec<std::variant_alternative_t<
+                            I, std::variant<Ts...>>>::decode(bytes)),
+                    0)
+                 : 0),
+     ...);
+    return res;
+  }
+};
+
+namespace expr_binary {
+
+inline void putVarint(std::uint64_t n, std::string &out) {
+  while (n >= 0x80) {
+    out.push_back(static_cast<char>((n & 0x7f) | 0x80));
+    n >>= 7;
+  }
+  out.push_back(static_cast<char>(n));
+}
+
+inline std::size_t varintSize(std::uint64_t n) {
+  std::size_t size = 1;
+  while (n >= 0x80) {
+    n >>= 7;
+    size++;
+  }
+  return size;
+}
+
+inline std::uint64_t getVarint(const unsigned char *&p,
+                               const unsigned char *end) {
+  std::uint64_t n = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    unsigned char byte = *p++;
+    n |= std::uint64_t(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return n;
+  }
+  throw std::runtime_error("truncated serialized Expr");
+}
+
+inline void putU32(std::uint32_t n, std::string &out) {
+  for (int i = 0; i < 4; i++)
+    out.push_back(static_cast<char>((n >> (8 * i)) & 0xff));
+}
+
+inline std::uint32_t getU32(const unsigned char *p) {
+  return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 |
+         std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+}
+
+inline constexpr std::size_t header_size = 20;
+
+// Two passes over the tree: the first interns the strings and measures every
+// subtree, the second writes the nodes in the same order.
+template <typename T> class Writer {
+public:
+  std::string write(const Expr<T> &expr) {
+    root_size = measure(expr);
+    std::string nodes;
+    nodes.reserve(root_size);
+    emit(expr, nodes);
+
+    std::string out("CPEX", 4);
+    out.push_back(static_cast<char>(expr_format_version));
+    out.append(3, '\0');
+    std::uint32_t string_bytes = 0;
+    for (auto &s : strings)
+      string_bytes += s.size();
+    putU32(strings.size(), out);
+    putU32(string_bytes, out);
+    putU32(nodes.size(), out);
+    std::uint32_t offset = 0;
+    for (auto &s : strings) {
+      putU32(offset, out);
+      offset += s.size();
+    }
+    putU32(offset, out);
+    for (auto &s : strings)
+      out += s;
+    return out + nodes;
+  }
+
+private:
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, std::uint32_t> index;
+  std::vector<std::uint32_t> refs;      // string index per node, pre-order
+  std::vector<std::uint64_t> lhs_sizes; // per infix node, pre-order
+  std::size_t next_ref = 0, next_lhs = 0;
+  std::uint64_t root_size = 0;
+
+  std::uint32_t intern(std::string s) {
+    auto [it, inserted] = index.emplace(s, strings.size());
+    if (inserted)
+      strings.push_back(std::move(s));
+    return it->second;
+  }
+
+  std::uint64_t measure(const Expr<T> &expr) {
+    return cpparsec::growStack([&] {
+      return std::visit(
+          [this](auto &&x) -> std::uint64_t {
+            using U = std::decay_t<decltype(x)>;
+            std::uint32_t ref;
+            if constexpr (std::is_same_v<U, T>) {
+              std::string bytes;
+              LeafCodec<T>::encode(x, bytes);
+              refs.push_back(ref = intern(std::move(bytes)));
+              return 1 + varintSize(ref);
+            } else if constexpr (std::is_same_v<U, InfixOperation<T>>) {
+              refs.push_back(ref = intern(x.type));
+              std::size_t slot = lhs_sizes.size();
+              lhs_sizes.push_back(0);
+              std::uint64_t lhs = measure(*x.lhs), rhs = measure(*x.rhs);
+              lhs_sizes[slot] = lhs;
+              return 1 + varintSize(ref) + varintSize(lhs) + lhs + rhs;
+            } else {
+              refs.push_back(ref = intern(x.type));
+              return 1 + varintSize(ref) + measure(*x.a);
+            }
+          },
+          expr.tree);
+    });
+  }
+
+  // the result is only there because growStack needs one
+  bool emit(const Expr<T> &expr, std::string &out) {
+    return cpparsec::growStack([&] {
+      std::visit(
+          [&](auto &&x) {
+            using U = std::decay_t<decltype(x)>;
+            ExprOp op = std::is_same_v<U, T>                     ? ExprOp::Leaf
+                        : std::is_same_v<U, PrefixOperation<T>>  ? ExprOp::Prefix
+                        : std::is_same_v<U, PostfixOperation<T>> ? ExprOp::Postfix
+                                                                 : ExprOp::Infix;
+            out.push_back(static_cast<char>(op));
+            putVarint(refs[next_ref++], out);
+            if constexpr (std::is_same_v<U, InfixOperation<T>>) {
+              putVarint(lhs_sizes[next_lhs++], out);
+              emit(*x.lhs, out);
+              emit(*x.rhs, out);
+            } else if constexpr (!std::is_same_v<U, T>) {
+              emit(*x.a, out);
+            }
+          },
+          expr.tree);
+      return true;
+    });
+  }
+};
+
+} // namespace expr_binary
+
+template <typename T> std::string serializeExpr(const Expr<T> &expr) {
+  return expr_binary::Writer<T>().write(expr);
+}
+
+// Read-only view over serialized bytes, which have to outlive it. Only the
+// header is checked up front, nodes are decoded as they are visited.
+template <typename T> class ExprView {
+public:
+  class Node {
+  public:
+    ExprOp kind() const { return static_cast<ExprOp>(*at); }
+    bool is_leaf() const { return kind() == ExprOp::Leaf; }
+    // operator name, for everything but leaves
+    std::string_view op() const { return view->string(ref()); }
+    // encoded leaf, LeafCodec<T>::decode of it is leaf()
+    std::string_view leaf_bytes() const { return view->string(ref()); }
+    T leaf() const { return LeafCodec<T>::decode(leaf_bytes()); }
+    // operand of a prefix or postfix node, lhs of an infix node
+    Node child() const { return Node(view, skipHeader(nullptr)); }
+    Node lhs() const { return child(); }
+    Node rhs() const {
+      std::uint64_t lhs_size = 0;
+      const unsigned char *p = skipHeader(&lhs_size);
+      if (lhs_size > std::uint64_t(view->nodes_end - p))
+        throw std::runtime_error("truncated serialized Expr");
+      return Node(view, p + lhs_size);
+    }
+
+    Expr<T> to_expr() const {
+      return cpparsec::growStack([&]() -> Expr<T> {
+        switch (kind()) {
+        case ExprOp::Leaf:
+          return Expr<T>(leaf());
+        case ExprOp::Prefix:
+          return Expr<T>(PrefixOperation<T>(std::string(op()), child().to_expr()));
+        case ExprOp::Postfix:
+          return Expr<T>(
+              PostfixOperation<T>(std::string(op()), child().to_expr()));
+        default:
+          return Expr<T>(InfixOperation<T>(std::string(op()), lhs().to_expr(),
+                                           rhs().to_expr()));
+        }
+      });
+    }
+
+  private:
+    friend class ExprView;
+    const ExprView *view;
+    const unsigned char *at;
+    Node(const ExprView *view, const unsigned char *at) : view(view), at(at) {
+      if (at >= view->nodes_end || *at > std::uint8_t(ExprOp::Infix))
+        throw std::runtime_error("bad node in serialized Expr");
+    }
+
+    std::uint32_t ref() const {
+      const unsigned char *p = at + 1;
+      return expr_binary::getVarint(p, view->nodes_end);
+    }
+    const unsigned char *skipHeader(std::uint64_t *lhs_size) const {
+      const unsigned char *p = at + 1;
+      expr_binary::getVarint(p, view->nodes_end);
+      if (kind() == ExprOp::Infix) {
+        std::uint64_t size = expr_binary::getVarint(p, view->nodes_end);
+        if (lhs_size != nullptr)
+          *lhs_size = size;
+      }
+      return p;
+    }
+  };
+
+  explicit ExprView(std::string_view bytes) {
+    using namespace expr_binary;
+    auto data = reinterpret_cast<const unsigned char *>(bytes.data());
+    if (bytes.size() < header_size || bytes.substr(0, 4) != "CPEX")
+      throw std::runtime_error("not a serialized Expr");
+    if (data[4] != expr_format_version)
+      throw std::runtime_error("unsupported serialized Expr version");
+    string_count = getU32(data + 8);
+    std::uint64_t string_bytes = getU32(data + 12), node_bytes = getU32(data + 16);
+    offsets = data + header_size;
+    strings = offsets + 4 * (std::uint64_t(string_count) + 1);
+    nodes_begin = strings + string_bytes;
+    nodes_end = nodes_begin + node_bytes;
+    if (header_size + 4 * (std::uint64_t(string_count) + 1) + string_bytes +
+                node_bytes !=
+            bytes.size() ||
+        node_bytes == 0)
+      throw std::runtime_error("truncated serialized Expr");
+  }
+
+  Node root() const { return Node(this, nodes_begin); }
+  Expr<T> to_expr() const { return root().to_expr(); }
+
+  std::string_view string(std::uint32_t i) const {
+    using expr_binary::getU32;
+    if (i >= string_count)
+      throw std::runtime_error("bad string index in serialized Expr");
+    std::uint32_t begin = getU32(offsets + 4 * i),
+                  end = getU32(offsets + 4 * (i + 1));
+    if (begin > end || end > nodes_begin - strings)
+      throw std::runtime_error("bad string offset in serialized Expr");
+    return std::string_view(reinterpret_cast<const char *>(strings) + begin,
+                            end - begin);
+  }
+
+private:
+  std::uint32_t string_count;
+  const unsigned char *offsets, *strings, *nodes_begin, *nodes_end;
+};
+
+#ifdef CPPARSEC_HAS_MMAP
+
+// read-only mapping of a whole file
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("can't open " + path);
+    struct stat st {};
+    if (fstat(fd, &st) == 0)
+      length = static_cast<std::size_t>(st.st_size);
+    if (length > 0)
+      addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+      throw std::runtime_error("can't map " + path);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+    if (addr != nullptr && addr != MAP_FAILED)
+      munmap(addr, length);
+  }
+
+  std::string_view bytes() const {
+    return length == 0 ? std::string_view()
+                       : std::string_view(static_cast<const char *>(addr),
+                                          length);
+  }
+
+private:
+  void *addr = nullptr;
+  std::size_t length = 0;
+};
+
+#endif
+
+#endif
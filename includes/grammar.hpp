@@ -0,0 +1,440 @@
+#ifndef GRAMMARHPP
+#define GRAMMARHPP
+
+#include "Parser.hpp"
+#include "automaton.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// An inspectable description of a recognizer, built with the same vocabulary
+// as cpparsec::Parsers. Unlike a Parser it can be analyzed and compiled:
+// Grammar::compile turns every regular subgraph into a single DFA.
+namespace cpparsec::Grammar {
+
+struct Node;
+
+class Rule {
+public:
+  std::shared_ptr<const Node> node;
+
+  Rule() = default;
+  Rule(std::shared_ptr<const Node> node) : node(std::move(node)) {}
+
+  const Node *operator->() const { return node.get(); }
+  const Node &operator*() const { return *node; }
+
+  Rule operator||(const Rule &other) const;
+  Rule andThen(const Rule &other) const;
+  Rule zeroOrMore() const;
+  Rule oneOrMore() const;
+  // only for single character rules, like Parser<char>::filter
+  Rule filter(Fn<bool(char)> pred, std::string name = "pred") const;
+};
+
+struct Node {
+  enum class Kind { Literal, Class, Filter, Seq, Alt, Repeat, Opaque };
+  Kind kind;
+  std::string text; // bytes of a literal, display name of the rest
+  CharSet set;      // Class
+  std::vector<Rule> children;
+  std::size_t min = 0, max = std::string::npos; // Repeat, max is 1 or npos
+  Parser<string_view> opaque;                   // Opaque, yields the match
+  Fn<bool(char)> pred;                          // Filter
+
+  Node(Kind kind, std::string text = {}, CharSet set = {})
+      : kind(kind), text(std::move(text)), set(set) {}
+};
+
+inline Rule make(Node node) {
+  return Rule(std::make_shared<const Node>(std::move(node)));
+}
+
+inline Rule String(string_view literal) {
+  return make(Node(Node::Kind::Literal, std::string(literal)));
+}
+inline Rule Class(const CharSet &set, std::string name) {
+  return make(Node(Node::Kind::Class, std::move(name), set));
+}
+inline Rule Character(char c) {
+  return Class(charSetOf(static_cast<unsigned char>(c)),
+               std::string("Character('") + c + "')");
+}
+template <size_t N> Rule Characters(const std::array<char, N> &chars) {
+  CharSet set;
+  for (unsigned char c : chars)
+    set.set(c);
+  return Class(set, "Characters(" + std::string(chars.begin(), chars.end()) +
+                        ")");
+}
+inline Rule Char_excluding(char c) {
+  return Class(~charSetOf(static_cast<unsigned char>(c)),
+               std::string("Char_excluding('") + c + "')");
+}
+template <size_t N>
+Rule Char_excluding_many(const std::array<char, N> &chars) {
+  CharSet set;
+  for (unsigned char c : chars)
+    set.set(c);
+  return Class(~set, "Char_excluding_many(" +
+                         std::string(chars.begin(), chars.end()) + ")");
+}
+inline Rule Repeat(const Rule &rule, std::size_t min, std::size_t max) {
+  Node node{Node::Kind::Repeat};
+  node.children = {rule};
+  node.min = min;
+  node.max = max;
+  return make(std::move(node));
+}
+inline Rule Optional(const Rule &rule) { return Repeat(rule, 0, 1); }
+
+// a subgraph that stays a plain parser, its result is replaced by the slice
+// of input it consumed
+template <typename T> Rule Opaque(std::string name, const Parser<T> &parser) {
+  Node node{Node::Kind::Opaque, std::move(name)};
+  node.opaque = Parser<string_view>(
+      [parser](string_view str)
+          -> std::optional<std::pair<string_view, string_view>> {
+        auto res = parser.parse(str);
+        RETURN_NULLOPT_IF_NO_VALUE(res);
+        auto rest = res.value().second;
+        return std::make_pair(str.substr(0, str.size() - rest.size()), rest);
+      });
+  return make(std::move(node));
+}
+
+template <typename... R> Rule oneOf(const R &...rules) {
+  Node node{Node::Kind::Alt};
+  node.children = {rules...};
+  return make(std::move(node));
+}
+template <typename... R> Rule zipMany(const R &...rules) {
+  Node node{Node::Kind::Seq};
+  node.children = {rules...};
+  return make(std::move(node));
+}
+
+inline Rule Rule::operator||(const Rule &other) const {
+  return oneOf(*this, other);
+}
+inline Rule Rule::andThen(const Rule &other) const {
+  return zipMany(*this, other);
+}
+inline Rule Rule::zeroOrMore() const {
+  return Repeat(*this, 0, std::string::npos);
+}
+inline Rule Rule::oneOrMore() const {
+  return Repeat(*this, 1, std::string::npos);
+}
+
+inline bool isCharRule(const Rule &rule) {
+  return rule->kind == Node::Kind::Class || rule->kind == Node::Kind::Filter;
+}
+
+// the characters a Class or Filter rule accepts
+inline CharSet charSet(const Rule &rule) {
+  if (rule->kind == Node::Kind::Class)
+    return rule->set;
+  return charSet(rule->children[0]) & charSetWhere(rule->pred);
+}
+
+inline Rule Rule::filter(Fn<bool(char)> pred, std::string name) const {
+  if (!isCharRule(*this))
+    throw std::runtime_error("Only character rules can be filtered");
+  Node node(Node::Kind::Filter, std::move(name));
+  node.children = {*this};
+  node.pred = std::move(pred);
+  return make(std::move(node));
+}
+
+inline const Rule Char = Class(~CharSet(), "Char");
+// same classes as the Parsers primitives, which cast to unsigned char
+// before calling the <cctype> functions
+inline const Rule Alpha =
+    Class(charSetWhere(Parsers::primitives::alpha), "Alpha");
+inline const Rule Digit =
+    Class(charSetWhere(Parsers::primitives::digit), "Digit");
+inline const Rule AlphaNum =
+    Class(charSetWhere(Parsers::primitives::alphaNum), "AlphaNum");
+inline const Rule WhiteSpace =
+    Class(charSetWhere(Parsers::primitives::whiteSpace), "WhiteSpace");
+
+// short, Parsers-like rendering of a rule
+inline std::string describe(const Rule &rule) {
+  auto list = [](const std::vector<Rule> &rules) {
+    std::string res;
+    for (auto &r : rules)
+      res += (res.empty() ? "" : ", ") + describe(r);
+    return res;
+  };
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    return "String(\"" + rule->text + "\")";
+  case Node::Kind::Class:
+    return rule->text;
+  case Node::Kind::Filter:
+    return describe(rule->children[0]) + ".filter(" + rule->text + ")";
+  case Node::Kind::Seq:
+    return "zipMany(" + list(rule->children) + ")";
+  case Node::Kind::Alt:
+    return "oneOf(" + list(rule->children) + ")";
+  case Node::Kind::Repeat:
+    if (rule->max == 1)
+      return "Optional(" + describe(rule->children[0]) + ")";
+    return describe(rule->children[0]) +
+           (rule->min == 0 ? ".zeroOrMore()" : ".oneOrMore()");
+  default:
+    return "Opaque(" + rule->text + ")";
+  }
+}
+
+inline bool nullable(const Rule &rule) {
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    return rule->text.empty();
+  case Node::Kind::Class:
+  case Node::Kind::Filter:
+    return false;
+  case Node::Kind::Seq:
+    return std::all_of(rule->children.begin(), rule->children.end(), nullable);
+  case Node::Kind::Alt:
+    return std::any_of(rule->children.begin(), rule->children.end(), nullable);
+  case Node::Kind::Repeat:
+    return rule->min == 0 || nullable(rule->children[0]);
+  default:
+    return true; // unknown, assume the worst
+  }
+}
+
+// bytes that can start a non-empty match
+inline CharSet first(const Rule &rule) {
+  CharSet res;
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    if (!rule->text.empty())
+      res.set(static_cast<unsigned char>(rule->text[0]));
+    return res;
+  case Node::Kind::Class:
+  case Node::Kind::Filter:
+    return charSet(rule);
+  case Node::Kind::Seq:
+    for (auto &child : rule->children) {
+      res |= first(child);
+      if (!nullable(child))
+        break;
+    }
+    return res;
+  case Node::Kind::Alt:
+    for (auto &child : rule->children)
+      res |= first(child);
+    return res;
+  case Node::Kind::Repeat:
+    return first(rule->children[0]);
+  default:
+    return ~res;
+  }
+}
+
+inline bool regular(const Rule &rule) {
+  if (rule->kind == Node::Kind::Opaque)
+    return false;
+  return std::all_of(rule->children.begin(), rule->children.end(), regular);
+}
+
+// A regular rule can only run as a DFA if the combinators would pick the
+// same match, which holds when every choice (alternation, loop or not) is
+// decided by the next byte. Returns the reason when it isn't.
+inline std::optional<std::string> nondeterminism(const Rule &rule,
+                                                 const CharSet &follow) {
+  switch (rule->kind) {
+  case Node::Kind::Seq: {
+    auto &children = rule->children;
+    for (std::size_t i = 0; i < children.size(); i++) {
+      CharSet rest;
+      bool rest_nullable = true;
+      for (std::size_t j = i + 1; j < children.size() && rest_nullable; j++) {
+        rest |= first(children[j]);
+        rest_nullable = nullable(children[j]);
+      }
+      auto res = nondeterminism(children[i], rest_nullable ? rest | follow
+                                                           : rest);
+      RETURN_OPT_IF_HAS_VALUE(res);
+    }
+    return std::nullopt;
+  }
+  case Node::Kind::Alt: {
+    auto &children = rule->children;
+    CharSet seen;
+    for (std::size_t i = 0; i < children.size(); i++) {
+      CharSet f = first(children[i]);
+      if ((seen & f).any())
+        return describe(rule) + ": alternatives share a first character";
+      seen |= f;
+      if (nullable(children[i]) && i + 1 != children.size())
+        return describe(rule) + ": only the last alternative may be empty";
+      auto res = nondeterminism(children[i], follow);
+      RETURN_OPT_IF_HAS_VALUE(res);
+    }
+    if (nullable(rule) && (seen & follow).any())
+      return describe(rule) + ": empty alternative overlaps what follows";
+    return std::nullopt;
+  }
+  case Node::Kind::Repeat: {
+    auto &child = rule->children[0];
+    if (nullable(child))
+      return describe(rule) + ": repeats a rule that can match nothing";
+    CharSet f = first(child);
+    if ((f & follow).any())
+      return describe(rule) + ": loop overlaps what follows";
+    return nondeterminism(child, f | follow);
+  }
+  default:
+    return std::nullopt;
+  }
+}
+
+inline Nfa::Fragment toNfa(const Rule &rule, Nfa &nfa) {
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    return nfa.literal(rule->text);
+  case Node::Kind::Class:
+  case Node::Kind::Filter:
+    return nfa.chars(charSet(rule));
+  case Node::Kind::Seq: {
+    auto res = nfa.empty();
+    for (auto &child : rule->children)
+      res = nfa.concat(res, toNfa(child, nfa));
+    return res;
+  }
+  case Node::Kind::Alt: {
+    auto res = toNfa(rule->children[0], nfa);
+    for (std::size_t i = 1; i < rule->children.size(); i++)
+      res = nfa.alternate(res, toNfa(rule->children[i], nfa));
+    return res;
+  }
+  case Node::Kind::Repeat: {
+    auto child = toNfa(rule->children[0], nfa);
+    if (rule->max == 1)
+      return nfa.optional(child);
+    return rule->min == 0 ? nfa.star(child) : nfa.plus(child);
+  }
+  default:
+    throw std::runtime_error("Opaque rules have no automaton");
+  }
+}
+
+using Opt = std::optional<std::pair<string_view, string_view>>;
+
+// runs the parsers one after the other, yields everything they consumed
+inline Parser<string_view> sequence(std::vector<Parser<string_view>> parts) {
+  return Parser<string_view>(
+      [parts = std::move(parts)](string_view str) -> Opt {
+        string_view rest = str;
+        for (auto &part : parts) {
+          auto res = part.parse(rest);
+          RETURN_NULLOPT_IF_NO_VALUE(res);
+          rest = res.value().second;
+        }
+        return std::make_pair(str.substr(0, str.size() - rest.size()), rest);
+      });
+}
+
+inline Parser<string_view> repeat(Parser<string_view> item, std::size_t min,
+                                  std::size_t max) {
+  return Parser<string_view>([item, min, max](string_view str) -> Opt {
+    string_view rest = str;
+    std::size_t count = 0;
+    while (count < max) {
+      auto res = item.parse(rest);
+      if (!res.has_value() || res.value().second.size() == rest.size())
+        break;
+      rest = res.value().second;
+      count++;
+    }
+    if (count < min)
+      return std::nullopt;
+    return std::make_pair(str.substr(0, str.size() - rest.size()), rest);
+  });
+}
+
+inline Parser<string_view> dfaParser(const Rule &rule) {
+  Nfa nfa;
+  auto frag = toNfa(rule, nfa);
+  auto dfa = std::make_shared<const Dfa>(Dfa::from(nfa, frag));
+  return Parser<string_view>([dfa](string_view str) -> Opt {
+    auto len = dfa->longest_match(str);
+    if (len == string_view::npos)
+      return std::nullopt;
+    return std::make_pair(str.substr(0, len), str.substr(len));
+  });
+}
+
+struct Compiled {
+  Parser<string_view> parser;
+  // subgraphs that still run as combinators, and why
+  std::vector<std::string> uncompiled;
+};
+
+inline Parser<string_view> compileInto(const Rule &rule,
+                                       std::vector<std::string> &report) {
+  bool is_regular = regular(rule);
+  if (is_regular) {
+    auto reason = nondeterminism(rule, CharSet());
+    if (!reason.has_value())
+      return dfaParser(rule);
+    // the children may still compile on their own
+    if (std::find(report.begin(), report.end(), reason.value()) ==
+        report.end())
+      report.push_back(reason.value());
+  }
+  switch (rule->kind) {
+  case Node::Kind::Seq: {
+    // compile maximal runs of regular children as one unit
+    std::vector<Parser<string_view>> parts;
+    auto &children = rule->children;
+    for (std::size_t i = 0; i < children.size();) {
+      std::size_t j = i;
+      while (!is_regular && j < children.size() && regular(children[j]))
+        j++;
+      if (j - i > 1) {
+        Node run{Node::Kind::Seq};
+        run.children.assign(children.begin() + i, children.begin() + j);
+        parts.push_back(compileInto(make(std::move(run)), report));
+        i = j;
+      } else {
+        parts.push_back(compileInto(children[i], report));
+        i++;
+      }
+    }
+    return sequence(std::move(parts));
+  }
+  case Node::Kind::Alt: {
+    auto res = compileInto(rule->children[0], report);
+    for (std::size_t i = 1; i < rule->children.size(); i++)
+      res = res || compileInto(rule->children[i], report);
+    return res;
+  }
+  case Node::Kind::Repeat:
+    return repeat(compileInto(rule->children[0], report), rule->min,
+                  rule->max);
+  case Node::Kind::Opaque:
+    report.push_back(describe(rule) + ": not a regular combinator");
+    return rule->opaque;
+  default: // a lone literal or character rule is always deterministic
+    return dfaParser(rule);
+  }
+}
+
+// Compiles every deterministic regular subgraph of the rule into one DFA.
+// The resulting parser yields the slice of input the rule matched.
+inline Compiled compile(const Rule &rule) {
+  Compiled res;
+  res.parser = compileInto(rule, res.uncompiled);
+  return res;
+}
+
+} // namespace cpparsec::Grammar
+
+#endif
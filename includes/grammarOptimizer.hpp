@@ -0,0 +1,310 @@
+#ifndef GRAMMAROPTIMIZERHPP
+#define GRAMMAROPTIMIZERHPP
+
+#include "grammar.hpp"
+
+#include <ostream>
+
+// Optimizer passes over Grammar::Rule. Rules are immutable, so every pass
+// returns a rewritten copy and shares the untouched subtrees. All passes
+// keep the combinator semantics (ordered choice, greedy repetition).
+namespace cpparsec::Grammar {
+
+inline Rule withChildren(const Rule &rule, std::vector<Rule> children) {
+  Node node = *rule;
+  node.children = std::move(children);
+  return make(std::move(node));
+}
+
+// rewrites bottom-up, fn sees a node whose children are already rewritten
+template <typename F> Rule transform(const Rule &rule, F &fn) {
+  if (rule->children.empty())
+    return fn(rule);
+  std::vector<Rule> children;
+  bool changed = false;
+  for (auto &child : rule->children) {
+    children.push_back(transform(child, fn));
+    changed |= children.back().node != child.node;
+  }
+  return fn(changed ? withChildren(rule, std::move(children)) : rule);
+}
+
+inline Rule Fail() { return Class(CharSet(), "Fail"); }
+
+inline bool same(const Rule &a, const Rule &b) {
+  if (a.node == b.node)
+    return true;
+  if (a->kind != b->kind || a->kind == Node::Kind::Opaque ||
+      a->kind == Node::Kind::Filter || a->text != b->text || a->set != b->set ||
+      a->min != b->min || a->max != b->max ||
+      a->children.size() != b->children.size())
+    return false;
+  for (std::size_t i = 0; i < a->children.size(); i++)
+    if (!same(a->children[i], b->children[i]))
+      return false;
+  return true;
+}
+
+// a chain of filters becomes a single table lookup
+inline Rule mergeFilters(const Rule &rule) {
+  auto fn = [](const Rule &r) {
+    if (r->kind != Node::Kind::Filter)
+      return r;
+    return Class(charSet(r), describe(r));
+  };
+  return transform(rule, fn);
+}
+
+// nested sequences are flattened and adjacent literals (including single
+// character classes) become one literal, i.e. one memcmp
+inline Rule fuseLiterals(const Rule &rule) {
+  auto fn = [](const Rule &r) -> Rule {
+    if (r->kind != Node::Kind::Seq)
+      return r;
+    std::vector<Rule> flat;
+    for (auto &child : r->children) {
+      if (child->kind == Node::Kind::Seq)
+        flat.insert(flat.end(), child->children.begin(), child->children.end());
+      else
+        flat.push_back(child);
+    }
+    std::vector<Rule> fused;
+    for (auto child : flat) {
+      if (child->kind == Node::Kind::Class && child->set.count() == 1) {
+        std::size_t c = 0;
+        while (!child->set.test(c))
+          c++;
+        child = String(std::string(1, static_cast<char>(c)));
+      }
+      if (child->kind == Node::Kind::Literal && !fused.empty() &&
+          fused.back()->kind == Node::Kind::Literal) {
+        fused.back() = String(fused.back()->text + child->text);
+      } else if (child->kind != Node::Kind::Literal || !child->text.empty()) {
+        fused.push_back(child);
+      }
+    }
+    if (fused.empty())
+      return String("");
+    if (fused.size() == 1)
+      return fused[0];
+    return withChildren(r, std::move(fused));
+  };
+  return transform(rule, fn);
+}
+
+// literal every match of the rule starts with
+inline string_view leadingLiteral(const Rule &rule) {
+  if (rule->kind == Node::Kind::Literal)
+    return rule->text;
+  if (rule->kind == Node::Kind::Seq &&
+      rule->children[0]->kind == Node::Kind::Literal)
+    return rule->children[0]->text;
+  return {};
+}
+
+inline Rule dropPrefix(const Rule &rule, std::size_t n) {
+  if (rule->kind == Node::Kind::Literal)
+    return String(string_view(rule->text).substr(n));
+  std::vector<Rule> children = rule->children;
+  children[0] = String(string_view(children[0]->text).substr(n));
+  return withChildren(rule, std::move(children));
+}
+
+// oneOf(String("lets"), String("letter")) becomes
+// zipMany(String("let"), oneOf(String("s"), String("ter"))), so the shared
+// prefix is compared once. Only neighbouring alternatives are grouped, which
+// keeps the order of choice intact.
+inline Rule factorPrefixes(const Rule &rule) {
+  Fn<Rule(const Rule &)> fn = [&fn](const Rule &r) -> Rule {
+    if (r->kind != Node::Kind::Alt)
+      return r;
+    std::vector<Rule> flat;
+    for (auto &child : r->children) {
+      if (child->kind == Node::Kind::Alt)
+        flat.insert(flat.end(), child->children.begin(), child->children.end());
+      else
+        flat.push_back(child);
+    }
+    std::vector<Rule> branches;
+    for (std::size_t i = 0; i < flat.size();) {
+      string_view prefix = leadingLiteral(flat[i]);
+      std::size_t j = i + 1;
+      while (!prefix.empty() && j < flat.size() &&
+             !leadingLiteral(flat[j]).empty() &&
+             leadingLiteral(flat[j])[0] == prefix[0]) {
+        string_view other = leadingLiteral(flat[j]);
+        std::size_t len = 0;
+        while (len < prefix.size() && len < other.size() &&
+               prefix[len] == other[len])
+          len++;
+        prefix = prefix.substr(0, len);
+        j++;
+      }
+      if (j - i == 1) {
+        branches.push_back(flat[i]);
+      } else {
+        std::vector<Rule> rests;
+        for (std::size_t k = i; k < j; k++)
+          rests.push_back(fuseLiterals(dropPrefix(flat[k], prefix.size())));
+        branches.push_back(fuseLiterals(
+            zipMany(String(prefix), fn(withChildren(r, std::move(rests))))));
+      }
+      i = j;
+    }
+    if (branches.size() == 1)
+      return branches[0];
+    return withChildren(r, std::move(branches));
+  };
+  return transform(rule, fn);
+}
+
+// true if the rule can never match
+inline bool never(const Rule &rule) {
+  switch (rule->kind) {
+  case Node::Kind::Class:
+  case Node::Kind::Filter:
+    return charSet(rule).none();
+  case Node::Kind::Seq:
+    return std::any_of(rule->children.begin(), rule->children.end(), never);
+  case Node::Kind::Alt:
+    return std::all_of(rule->children.begin(), rule->children.end(), never);
+  case Node::Kind::Repeat:
+    return rule->min > 0 && never(rule->children[0]);
+  default:
+    return false;
+  }
+}
+
+// true if the rule can't fail
+inline bool always(const Rule &rule) {
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    return rule->text.empty();
+  case Node::Kind::Seq:
+    return std::all_of(rule->children.begin(), rule->children.end(), always);
+  case Node::Kind::Alt:
+    return std::any_of(rule->children.begin(), rule->children.end(), always);
+  case Node::Kind::Repeat:
+    return rule->min == 0 || always(rule->children[0]);
+  default:
+    return false;
+  }
+}
+
+// drops alternatives that can never be chosen: ones that can't match, ones
+// after an alternative that can't fail and repeats of an earlier one
+inline Rule eliminateDeadBranches(const Rule &rule) {
+  auto fn = [](const Rule &r) -> Rule {
+    switch (r->kind) {
+    case Node::Kind::Seq:
+      return never(r) ? Fail() : r;
+    case Node::Kind::Repeat:
+      if (never(r->children[0]))
+        return r->min == 0 ? String("") : Fail();
+      return r;
+    case Node::Kind::Alt: {
+      std::vector<Rule> live;
+      for (auto &child : r->children) {
+        if (never(child) ||
+            std::any_of(live.begin(), live.end(),
+                        [&](const Rule &x) { return same(x, child); }))
+          continue;
+        live.push_back(child);
+        if (always(child))
+          break;
+      }
+      if (live.empty())
+        return Fail();
+      if (live.size() == 1)
+        return live[0];
+      if (live.size() == r->children.size())
+        return r;
+      return withChildren(r, std::move(live));
+    }
+    default:
+      return r;
+    }
+  };
+  return transform(rule, fn);
+}
+
+// indented tree, one node per line
+inline void dump(const Rule &rule, std::ostream &out, int depth = 0) {
+  out << std::string(2 * depth, ' ');
+  switch (rule->kind) {
+  case Node::Kind::Seq:
+    out << "zipMany";
+    break;
+  case Node::Kind::Alt:
+    out << "oneOf";
+    break;
+  case Node::Kind::Repeat:
+    out << (rule->max == 1      ? "Optional"
+            : rule->min == 0    ? "zeroOrMore"
+                                : "oneOrMore");
+    break;
+  case Node::Kind::Filter:
+    out << "filter(" << rule->text << ")";
+    break;
+  default:
+    out << describe(rule);
+  }
+  out << '\n';
+  for (auto &child : rule->children)
+    dump(child, out, depth + 1);
+}
+
+// runs every pass, and dumps the graph before and after if out is given
+inline Rule optimize(const Rule &rule, std::ostream *out = nullptr) {
+  Rule res = eliminateDeadBranches(
+      factorPrefixes(fuseLiterals(mergeFilters(rule))));
+  if (out != nullptr) {
+    *out << "before:\n";
+    dump(rule, *out, 1);
+    *out << "after:\n";
+    dump(res, *out, 1);
+  }
+  return res;
+}
+
+// Executable parser with the same semantics as the combinators the rule
+// describes, yielding the slice of input it matched
+inline Parser<string_view> lower(const Rule &rule) {
+  switch (rule->kind) {
+  case Node::Kind::Literal:
+    return Parser<string_view>([lit = rule->text](string_view str) -> Opt {
+      if (!str.starts_with(lit))
+        return std::nullopt;
+      return std::make_pair(str.substr(0, lit.size()), str.substr(lit.size()));
+    });
+  case Node::Kind::Class:
+    return Parser<string_view>([set = rule->set](string_view str) -> Opt {
+      if (str.empty() || !set.test(static_cast<unsigned char>(str[0])))
+        return std::nullopt;
+      return std::make_pair(str.substr(0, 1), str.substr(1));
+    });
+  case Node::Kind::Filter:
+    return lower(rule->children[0])
+        .filter([pred = rule->pred](string_view c) { return pred(c[0]); });
+  case Node::Kind::Seq: {
+    std::vector<Parser<string_view>> parts;
+    for (auto &child : rule->children)
+      parts.push_back(lower(child));
+    return sequence(std::move(parts));
+  }
+  case Node::Kind::Alt: {
+    auto res = lower(rule->children[0]);
+    for (std::size_t i = 1; i < rule->children.size(); i++)
+      res = res || lower(rule->children[i]);
+    return res;
+  }
+  case Node::Kind::Repeat:
+    return repeat(lower(rule->children[0]), rule->min, rule->max);
+  default:
+    return rule->opaque;
+  }
+}
+
+} // namespace cpparsec::Grammar
+
+#endif
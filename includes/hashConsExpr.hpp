@@ -0,0 +1,256 @@
+#ifndef HASHCONSEXPRHPP
+#define HASHCONSEXPRHPP
+
+#include "buildExpr.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Hash-consed expression nodes. Every structurally distinct subtree exists
+// exactly once inside an ExprInterner, so two nodes are equal iff their
+// pointers are equal and hashing a node is a field read.
+template <typename T> struct ExprNode {
+  enum class Kind : std::uint8_t { Leaf, Prefix, Postfix, Infix };
+  Kind kind;
+  std::string_view op; // points into the interner's name pool, empty for leaf
+  T leaf{};
+  const ExprNode *lhs = nullptr; // the only child of prefix/postfix nodes
+  const ExprNode *rhs = nullptr;
+  std::size_t hash = 0;
+  std::size_t id = 0; // dense, in creation order
+
+  bool is_leaf() const { return kind == Kind::Leaf; }
+};
+
+template <typename T> class ExprInterner {
+public:
+  using Node = ExprNode<T>;
+
+  ExprInterner() = default;
+  // nodes, the index and operator names are allocated from resource (leaf
+  // values that allocate themselves still use their own allocator)
+  explicit ExprInterner(std::pmr::memory_resource *resource)
+      : nodes(resource), index(resource), names(resource) {}
+  ExprInterner(const ExprInterner &) = delete;
+  ExprInterner &operator=(const ExprInterner &) = delete;
+
+  const Node *leaf(const T &val) {
+    Node n{Node::Kind::Leaf, {}, val};
+    n.hash = hash_combine(std::hash<T>{}(val), 0x9e3779b9);
+    return intern(std::move(n));
+  }
+  const Node *prefix(string_view op_name, const Node *x) {
+    return unary(Node::Kind::Prefix, op_name, x);
+  }
+  const Node *postfix(string_view op_name, const Node *x) {
+    return unary(Node::Kind::Postfix, op_name, x);
+  }
+  const Node *infix(string_view op_name, const Node *lhs, const Node *rhs) {
+    Node n{Node::Kind::Infix, intern_name(op_name)};
+    n.lhs = lhs;
+    n.rhs = rhs;
+    n.hash = hash_combine(hash_combine(name_hash(n), lhs->hash), rhs->hash);
+    return intern(std::move(n));
+  }
+
+  // converts an owning tree, sharing every repeated subtree
+  const Node *intern(const Expr<T> &expr) {
+    return std::visit(
+        [this](const auto &x) -> const Node * {
+          using U = std::decay_t<decltype(x)>;
+          if constexpr (std::is_same_v<U, PrefixOperation<T>>) {
+            return prefix(x.type, intern(*x.a));
+          } else if constexpr (std::is_same_v<U, PostfixOperation<T>>) {
+            return postfix(x.type, intern(*x.a));
+          } else if constexpr (std::is_same_v<U, InfixOperation<T>>) {
+            return infix(x.type, intern(*x.lhs), intern(*x.rhs));
+          } else {
+            return leaf(x);
+          }
+        },
+        expr.tree);
+  }
+
+  // expands a node back into an owning tree
+  static Expr<T> to_expr(const Node *node) {
+    switch (node->kind) {
+    case Node::Kind::Leaf:
+      return Expr<T>(node->leaf);
+    case Node::Kind::Prefix:
+      return Expr<T>(
+          PrefixOperation<T>(std::string(node->op), to_expr(node->lhs)));
+    case Node::Kind::Postfix:
+      return Expr<T>(
+          PostfixOperation<T>(std::string(node->op), to_expr(node->lhs)));
+    default:
+      return Expr<T>(InfixOperation<T>(
+          std::string(node->op), to_expr(node->lhs), to_expr(node->rhs)));
+    }
+  }
+
+  // number of unique nodes
+  std::size_t size() const { return nodes.size(); }
+
+  // Keeps only the nodes reachable from roots and forgets the others. The
+  // kept nodes move, so every pointer into the interner is invalidated; the
+  // result maps each kept node's old address to its new one.
+  std::unordered_map<const Node *, const Node *>
+  retain(const std::vector<const Node *> &roots) {
+    std::unordered_set<const Node *> reachable;
+    std::vector<const Node *> stack(roots.begin(), roots.end());
+    while (!stack.empty()) {
+      const Node *node = stack.back();
+      stack.pop_back();
+      if (node == nullptr || !reachable.insert(node).second)
+        continue;
+      stack.push_back(node->lhs);
+      stack.push_back(node->rhs);
+    }
+    // children are created before their parents, so in id order they are
+    // moved first
+    std::vector<const Node *> order(reachable.begin(), reachable.end());
+    std::sort(order.begin(), order.end(),
+              [](const Node *a, const Node *b) { return a->id < b->id; });
+
+    std::unordered_map<const Node *, const Node *> moved;
+    std::pmr::deque<Node> kept(nodes.get_allocator());
+    decltype(index) kept_index(order.size(), NodeHash{}, NodeEq{},
+                               index.get_allocator());
+    for (const Node *node : order) {
+      Node n = *node;
+      n.id = kept.size();
+      if (n.lhs != nullptr)
+        n.lhs = moved.at(n.lhs);
+      if (n.rhs != nullptr)
+        n.rhs = moved.at(n.rhs);
+      kept.push_back(std::move(n));
+      kept_index.insert(&kept.back());
+      moved.emplace(node, &kept.back());
+    }
+    nodes.swap(kept);
+    index.swap(kept_index);
+    return moved;
+  }
+
+private:
+  struct NodeHash {
+    std::size_t operator()(const Node *n) const { return n->hash; }
+  };
+  struct NodeEq {
+    bool operator()(const Node *a, const Node *b) const {
+      if (a->hash != b->hash || a->kind != b->kind)
+        return false;
+      if (a->kind == Node::Kind::Leaf)
+        return a->leaf == b->leaf;
+      // op names are interned, children are already unique
+      return a->op.data() == b->op.data() && a->lhs == b->lhs &&
+             a->rhs == b->rhs;
+    }
+  };
+
+  std::pmr::deque<Node> nodes; // stable addresses
+  std::pmr::unordered_set<const Node *, NodeHash, NodeEq> index;
+  std::pmr::unordered_set<std::pmr::string> names;
+
+  static std::size_t hash_combine(std::size_t seed, std::size_t v) {
+    return seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+  }
+  static std::size_t name_hash(const Node &n) {
+    return hash_combine(std::hash<string_view>{}(n.op),
+                        static_cast<std::size_t>(n.kind));
+  }
+
+  string_view intern_name(string_view op_name) {
+    return *names.emplace(op_name).first;
+  }
+
+  const Node *unary(typename Node::Kind kind, string_view op_name,
+                    const Node *x) {
+    Node n{kind, intern_name(op_name)};
+    n.lhs = x;
+    n.hash = hash_combine(name_hash(n), x->hash);
+    return intern(std::move(n));
+  }
+
+  const Node *intern(Node &&n) {
+    auto it = index.find(&n);
+    if (it != index.end())
+      return *it;
+    n.id = nodes.size();
+    nodes.push_back(std::move(n));
+    index.insert(&nodes.back());
+    return &nodes.back();
+  }
+};
+
+// Builder for buildExprWith that produces hash-consed nodes
+template <typename T> struct HashConsBuilder {
+  using node_type = const ExprNode<T> *;
+  ExprInterner<T> &interner;
+
+  node_type leaf(T val) { return interner.leaf(val); }
+  node_type prefix(const std::string &op_name, node_type x) {
+    return interner.prefix(op_name, x);
+  }
+  node_type postfix(const std::string &op_name, node_type x) {
+    return interner.postfix(op_name, x);
+  }
+  node_type infix(const std::string &op_name, node_type lhs, node_type rhs) {
+    return interner.infix(op_name, lhs, rhs);
+  }
+  std::optional<node_type> rotate(const std::string &op_name, node_type left,
+                                  node_type right) {
+    if (right->kind != ExprNode<T>::Kind::Infix || right->op != op_name)
+      return std::nullopt;
+    return interner.infix(op_name, interner.infix(op_name, left, right->lhs),
+                          right->rhs);
+  }
+};
+
+// Same as buildExpressionParser but the nodes live in (and are shared
+// through) the given interner, which has to outlive the parser
+template <typename T>
+Parser<const ExprNode<T> *>
+buildHashConsedExpressionParser(std::span<ExprType> table,
+                                const Parser<T> &base_parser,
+                                ExprInterner<T> &interner) {
+  using RetType = std::optional<std::pair<const ExprNode<T> *, string_view>>;
+  return Parser<const ExprNode<T> *>(
+      Fn<RetType(string_view)>([=, &interner](string_view str) {
+        HashConsBuilder<T> builder{interner};
+        return buildExprWith(table, base_parser, str, builder);
+      }));
+}
+
+// Evaluates every unique node at most once. step computes a node's value and
+// calls back into the evaluator for the children it needs.
+template <typename T, typename R> class MemoEvaluator {
+public:
+  using Step = Fn<R(const ExprNode<T> &, MemoEvaluator &)>;
+
+  explicit MemoEvaluator(Step step) : step(std::move(step)) {}
+
+  R operator()(const ExprNode<T> *node) {
+    auto it = cache.find(node);
+    if (it != cache.end())
+      return it->second;
+    R res = step(*node, *this);
+    cache.emplace(node, res);
+    return res;
+  }
+
+  // number of nodes actually evaluated
+  std::size_t evaluations() const { return cache.size(); }
+
+private:
+  Step step;
+  std::unordered_map<const ExprNode<T> *, R> cache;
+};
+
+#endif
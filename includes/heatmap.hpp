@@ -0,0 +1,261 @@
+#ifndef HEATMAPHPP
+#define HEATMAPHPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpparsec {
+
+// Backtracking diagnostics. While a ParseContext with a Heatmap runs, every
+// primitive (the parsers made with primitive(), Char based ones and String)
+// reports the bytes it examined, and the heatmap counts per input offset how
+// often each byte was read. Reads are attributed to the innermost Parsers::named
+// parser around them. Bytes read more than once are what backtracking cost:
+// an operator|| alternative starting over, buildExpr retrying a left
+// operand, Parens scanning nested brackets again.
+//
+//   heat::Heatmap map;
+//   ParseContext ctx;
+//   ctx.setHeatmap(&map);
+//   ctx.run(grammar, sample);
+//   std::cout << map.text(3);
+namespace heat {
+
+class Heatmap {
+public:
+  // reads attributed to one named parser
+  struct Source {
+    std::string name;
+    std::size_t reads = 0;
+    std::size_t rereads = 0; // of bytes that had been read before
+    std::vector<std::uint32_t> counts; // per offset, empty until it reads
+  };
+  // a run of bytes read more than a threshold
+  struct HotRange {
+    std::size_t begin = 0, end = 0;
+    std::uint32_t max = 0;
+    std::string parser; // the one that read it most, or first on a tie
+  };
+
+  Heatmap() { reset({}); }
+
+  // forgets everything and starts over on input
+  void reset(std::string_view input) {
+    whole = input;
+    totals.assign(input.size(), 0);
+    sources_.assign(1, Source{"(unnamed)", 0, 0, {}});
+    index.clear();
+    active = 0;
+  }
+
+  std::string_view input() const { return whole; }
+  // how often each byte of the input was read
+  const std::vector<std::uint32_t> &counts() const { return totals; }
+  // sources()[0] collects reads outside of any named parser
+  const std::vector<Source> &sources() const { return sources_; }
+
+  std::size_t reads() const {
+    std::size_t n = 0;
+    for (const auto &src : sources_)
+      n += src.reads;
+    return n;
+  }
+
+  std::vector<HotRange> hot(std::uint32_t threshold) const {
+    std::vector<HotRange> ranges;
+    for (std::size_t i = 0; i < totals.size();) {
+      if (totals[i] <= threshold) {
+        i++;
+        continue;
+      }
+      HotRange range{i, i, 0, {}};
+      for (; range.end < totals.size() && totals[range.end] > threshold;
+           range.end++)
+        range.max = std::max(range.max, totals[range.end]);
+      range.parser = topSource(range.begin, range.end);
+      i = range.end;
+      ranges.push_back(std::move(range));
+    }
+    return ranges;
+  }
+
+  // Each input line with a row of read counts under it (. for none, 1-9,
+  // + for 10 or more), then the ranges read more than threshold times and
+  // the reads per named parser.
+  std::string text(std::uint32_t threshold) const {
+    std::string out = "reads per byte (. none, 1-9, + for 10 or more)\n";
+    std::size_t start = 0;
+    while (start < whole.size()) {
+      std::size_t end = std::min(whole.find('\n', start), whole.size());
+      std::string line, heat;
+      for (std::size_t i = start; i < end; i++) {
+        auto c = static_cast<unsigned char>(whole[i]);
+        line += c < ' ' ? ' ' : whole[i];
+        heat += totals[i] == 0  ? '.'
+                : totals[i] > 9 ? '+'
+                                : char('0' + totals[i]);
+      }
+      out += line + '\n' + heat + '\n';
+      start = end + 1;
+    }
+    out += "read more than " + std::to_string(threshold) + " times:\n";
+    for (const auto &range : hot(threshold))
+      out += "  " + std::to_string(range.begin) + ".." +
+             std::to_string(range.end) + " up to " +
+             std::to_string(range.max) + ", mostly by " + range.parser + '\n';
+    out += "parser reads rereads:\n";
+    for (const auto &src : sources_)
+      out += "  " + src.name + ' ' + std::to_string(src.reads) + ' ' +
+             std::to_string(src.rereads) + '\n';
+    return out;
+  }
+
+  // offset,count,parser with the parser that read the byte most
+  std::string csv() const {
+    std::string out = "offset,count,parser\n";
+    for (std::size_t i = 0; i < totals.size(); i++) {
+      std::string name = totals[i] == 0 ? "" : topSource(i, i + 1);
+      std::string quoted;
+      for (char c : name)
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+      out += std::to_string(i) + ',' + std::to_string(totals[i]) + ",\"" +
+             quoted + "\"\n";
+    }
+    return out;
+  }
+
+  std::string json(std::uint32_t threshold) const {
+    std::string out = "{\"size\":" + std::to_string(totals.size());
+    out += ",\"counts\":[";
+    for (std::size_t i = 0; i < totals.size(); i++) {
+      if (i != 0)
+        out += ',';
+      out += std::to_string(totals[i]);
+    }
+    out += "],\"parsers\":[";
+    for (std::size_t i = 0; i < sources_.size(); i++) {
+      if (i != 0)
+        out += ',';
+      out += "{\"name\":" + quote(sources_[i].name);
+      out += ",\"reads\":" + std::to_string(sources_[i].reads);
+      out += ",\"rereads\":" + std::to_string(sources_[i].rereads) + "}";
+    }
+    out += "],\"hot\":[";
+    auto ranges = hot(threshold);
+    for (std::size_t i = 0; i < ranges.size(); i++) {
+      if (i != 0)
+        out += ',';
+      out += "{\"begin\":" + std::to_string(ranges[i].begin);
+      out += ",\"end\":" + std::to_string(ranges[i].end);
+      out += ",\"max\":" + std::to_string(ranges[i].max);
+      out += ",\"parser\":" + quote(ranges[i].parser) + "}";
+    }
+    return out + "]}";
+  }
+
+  // called by primitives: n bytes from the start of str were examined
+  void examined(std::string_view str, std::size_t n) {
+    std::less<const char *> less;
+    if (less(str.data(), whole.data()) ||
+        less(whole.data() + whole.size(), str.data()))
+      return; // not part of the input, e.g. a copy made by the grammar
+    std::size_t begin = str.data() - whole.data();
+    std::size_t end = begin + std::min(n, whole.size() - begin);
+    Source &src = sources_[active];
+    if (src.counts.empty())
+      src.counts.assign(whole.size(), 0);
+    for (std::size_t i = begin; i < end; i++) {
+      src.rereads += totals[i] > 0;
+      totals[i]++;
+      src.counts[i]++;
+    }
+    src.reads += end - begin;
+  }
+
+  // reads from now on belong to name, returns what to restore with leave
+  std::size_t enter(const std::string &name) {
+    auto [it, added] = index.try_emplace(name, sources_.size());
+    if (added)
+      sources_.push_back(Source{name, 0, 0, {}});
+    return std::exchange(active, it->second);
+  }
+  void leave(std::size_t previous) { active = previous; }
+
+private:
+  std::string topSource(std::size_t begin, std::size_t end) const {
+    const Source *top = nullptr;
+    std::size_t top_reads = 0;
+    for (const auto &src : sources_) {
+      if (src.counts.empty())
+        continue;
+      std::size_t n = 0;
+      for (std::size_t i = begin; i < end; i++)
+        n += src.counts[i];
+      if (n > top_reads)
+        top = &src, top_reads = n;
+    }
+    return top == nullptr ? "" : top->name;
+  }
+
+  static std::string quote(std::string_view str) {
+    std::string out = "\"";
+    for (char c : str) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if (static_cast<unsigned char>(c) < ' ') {
+        const char *hex = "0123456789abcdef";
+        out += "\\u00";
+        out += hex[c >> 4];
+        out += hex[c & 0xf];
+      } else {
+        out += c;
+      }
+    }
+    return out + '"';
+  }
+
+  std::string_view whole;
+  std::vector<std::uint32_t> totals;
+  std::vector<Source> sources_;
+  std::unordered_map<std::string, std::size_t> index;
+  std::size_t active = 0;
+};
+
+// the heatmap of the running ParseContext, if it has one
+inline thread_local Heatmap *recorder = nullptr;
+
+inline void examined(std::string_view str, std::size_t n) {
+  if (recorder != nullptr) [[unlikely]]
+    recorder->examined(str, n);
+}
+
+// attributes reads to name for as long as it lives
+class Named {
+public:
+  explicit Named(const std::string &name) : map(recorder) {
+    if (map != nullptr) [[unlikely]]
+      previous = map->enter(name);
+  }
+  ~Named() {
+    if (map != nullptr) [[unlikely]]
+      map->leave(previous);
+  }
+  Named(const Named &) = delete;
+  Named &operator=(const Named &) = delete;
+
+private:
+  Heatmap *map;
+  std::size_t previous = 0;
+};
+
+} // namespace heat
+} // namespace cpparsec
+
+#endif
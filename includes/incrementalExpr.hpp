@@ -0,0 +1,171 @@
+#ifndef INCREMENTALEXPRHPP
+#define INCREMENTALEXPRHPP
+
+#include "hashConsExpr.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Re-parses a document after localized edits. Every call of the operator
+// search is remembered by the range of the document it looked at, with the
+// (hash-consed) subtree it built and how much of the range it consumed. An
+// edit drops the ranges that overlap it and shifts the ones after it, then
+// the search runs again and only descends into ranges it has not seen, so
+// the subtrees on either side of the edit are spliced into the new tree as
+// they are. What is searched again is the path from the root down to the
+// edit plus the edited text itself.
+//
+// The subtrees built for text that was edited away stay in the interner
+// until compact() drops them, so a long editing session should call it
+// every so often.
+template <typename T> class IncrementalExpr {
+public:
+  using Node = ExprNode<T>;
+  using Result = std::optional<std::pair<const Node *, string_view>>;
+
+  struct Stats {
+    std::size_t searched = 0; // calls of the operator search that ran
+    std::size_t recalled = 0; // calls answered from a remembered range
+    std::size_t kept = 0;     // ranges carried over by the last edit
+    std::size_t dropped = 0;  // ranges the last edit overlapped
+  };
+
+  IncrementalExpr(std::vector<ExprType> table, Parser<T> base_parser)
+      : table(std::move(table)), base_parser(std::move(base_parser)) {}
+  IncrementalExpr(const IncrementalExpr &) = delete;
+  IncrementalExpr &operator=(const IncrementalExpr &) = delete;
+
+  // parses a new document from scratch
+  Result parse(std::string text) {
+    doc = std::move(text);
+    memo.clear();
+    stats_ = {};
+    return run();
+  }
+
+  // replaces removed bytes at offset with inserted and parses again
+  Result edit(std::size_t offset, std::size_t removed, string_view inserted) {
+    if (offset > doc.size() || removed > doc.size() - offset)
+      throw std::out_of_range("IncrementalExpr::edit outside of the document");
+    doc.replace(offset, removed, inserted);
+
+    std::size_t edit_end = offset + removed;
+    std::unordered_map<Range, Entry, RangeHash> moved;
+    moved.reserve(memo.size());
+    stats_ = {};
+    for (auto &[range, entry] : memo) {
+      if (range.end <= offset) {
+        moved.emplace(range, entry);
+      } else if (range.begin >= edit_end) {
+        Range shifted = range;
+        shifted.begin = shifted.begin - removed + inserted.size();
+        shifted.end = shifted.end - removed + inserted.size();
+        moved.emplace(shifted, entry);
+      } else {
+        stats_.dropped++;
+        continue;
+      }
+      stats_.kept++;
+    }
+    memo = std::move(moved);
+    return run();
+  }
+
+  // Forgets the interned nodes that neither the current tree nor a
+  // remembered range refers to. Nodes returned before are invalidated, the
+  // current result is returned again with the nodes' new addresses.
+  Result compact() {
+    std::vector<const Node *> roots;
+    if (last.has_value())
+      roots.push_back(last.value().first);
+    for (const auto &[range, entry] : memo)
+      roots.push_back(entry.node);
+    auto moved = nodes.retain(roots);
+    for (auto &[range, entry] : memo)
+      if (entry.node != nullptr)
+        entry.node = moved.at(entry.node);
+    if (last.has_value())
+      last.value().first = moved.at(last.value().first);
+    return last;
+  }
+
+  const std::string &text() const { return doc; }
+  const ExprInterner<T> &interner() const { return nodes; }
+  // counters of the last parse or edit
+  Stats stats() const { return stats_; }
+
+  // the remembered result for a range of the document, as the search with
+  // the whole table (level 0) or a suffix of it left it
+  std::optional<Result> remembered(std::size_t begin, std::size_t end,
+                                   std::size_t level = 0) const {
+    auto it = memo.find(Range{table.size() - level, begin, end});
+    if (it == memo.end())
+      return std::nullopt;
+    return it->second.result(string_view(doc).substr(begin, end - begin));
+  }
+
+private:
+  struct Range {
+    std::size_t level, begin, end;
+    bool operator==(const Range &) const = default;
+  };
+  struct RangeHash {
+    std::size_t operator()(const Range &r) const {
+      std::size_t h = r.begin * 0x9e3779b97f4a7c15ULL;
+      h ^= r.end + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      return h ^ (r.level << 56);
+    }
+  };
+  struct Entry {
+    const Node *node = nullptr; // nullptr if the search failed
+    std::size_t consumed = 0;
+
+    Result result(string_view str) const {
+      if (node == nullptr)
+        return std::nullopt;
+      return std::make_optional(std::make_pair(node, str.substr(consumed)));
+    }
+  };
+
+  struct Builder : HashConsBuilder<T> {
+    IncrementalExpr &self;
+
+    Range range(std::size_t level, string_view str) const {
+      std::size_t begin = str.data() - self.doc.data();
+      return Range{level, begin, begin + str.size()};
+    }
+    std::optional<Result> recall(std::size_t level, string_view str) {
+      auto it = self.memo.find(range(level, str));
+      if (it == self.memo.end())
+        return std::nullopt;
+      self.stats_.recalled++;
+      return it->second.result(str);
+    }
+    void remember(std::size_t level, string_view str, const Result &res) {
+      self.stats_.searched++;
+      Entry entry;
+      if (res.has_value())
+        entry = Entry{res.value().first, str.size() - res.value().second.size()};
+      self.memo.insert_or_assign(range(level, str), entry);
+    }
+  };
+
+  Result run() {
+    Builder builder{{nodes}, *this};
+    last = buildExprWith(std::span<ExprType>(table), base_parser,
+                         string_view(doc), builder);
+    return last;
+  }
+
+  std::vector<ExprType> table;
+  Parser<T> base_parser;
+  ExprInterner<T> nodes;
+  std::string doc;
+  std::unordered_map<Range, Entry, RangeHash> memo;
+  Result last;
+  Stats stats_;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MEMORYHPP
+#define MEMORYHPP
+
+#include "Parser.hpp"
+
+#include <memory_resource>
+#include <vector>
+
+namespace cpparsec {
+
+// Where per-parse allocations go. While a ParseContext with a memory
+// resource runs, resource() returns it, otherwise the default resource. The
+// parsers below and an ExprInterner constructed with a resource allocate
+// from it, so a caller can hand each request a monotonic arena and release
+// everything the parse built at once:
+//
+//   std::pmr::monotonic_buffer_resource arena;
+//   ParseContext ctx;
+//   ctx.setMemoryResource(&arena);
+//   auto res = ctx.run(pmrSepBy(PosNum, Character(',')), input);
+//
+// The results point into the arena, so they must not outlive it.
+namespace memory {
+
+inline thread_local std::pmr::memory_resource *current = nullptr;
+
+inline std::pmr::memory_resource *resource() {
+  return current != nullptr ? current : std::pmr::get_default_resource();
+}
+
+} // namespace memory
+
+namespace Parsers {
+
+// zeroOrMore into a vector allocated from memory::resource()
+template <typename T>
+Parser<std::pmr::vector<T>> pmrZeroOrMore(const Parser<T> &parser) {
+  return Parser<std::pmr::vector<T>>([parser](string_view str) {
+    std::pmr::vector<T> matches(memory::resource());
+    auto res = parser.parse(str);
+    while (res.has_value()) {
+      matches.push_back(std::move(res.value().first));
+      str = res.value().second;
+      res = parser.parse(str);
+    }
+    cut::checkRewind(str);
+    return std::make_optional(std::make_pair(std::move(matches), str));
+  });
+}
+
+template <typename T>
+Parser<std::pmr::vector<T>> pmrOneOrMore(const Parser<T> &parser) {
+  return pmrZeroOrMore(parser).filter(
+      [](const std::pmr::vector<T> &vec) { return !vec.empty(); });
+}
+
+// sepBy into a vector allocated from memory::resource()
+template <typename A, typename B>
+Parser<std::pmr::vector<A>> pmrSepBy(const Parser<A> &separatee,
+                                     const Parser<B> &separator) {
+  return Parser<std::pmr::vector<A>>(
+      [separatee, separator](string_view str)
+          -> std::optional<std::pair<std::pmr::vector<A>, string_view>> {
+        std::pmr::vector<A> items(memory::resource());
+        auto item = separatee.parse(str);
+        if (!item.has_value()) {
+          cut::checkRewind(str);
+          return std::make_pair(std::move(items), str);
+        }
+        while (true) {
+          items.push_back(std::move(item.value().first));
+          str = item.value().second;
+          if (str.empty())
+            break;
+          auto sep = separator.parse(str);
+          RETURN_NULLOPT_IF_NO_VALUE(sep);
+          item = separatee.parse(sep.value().second);
+          RETURN_NULLOPT_IF_NO_VALUE(item);
+        }
+        return std::make_pair(std::move(items), str);
+      });
+}
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef PARALLELHPP
+#define PARALLELHPP
+
+#include "Parser.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+namespace cpparsec {
+
+// How parallelSepBy splits its input. Without open/close brackets or a
+// quote character every separator byte is a candidate split point; with
+// them, one byte scan over the input skips separators that are nested or
+// quoted.
+struct ParallelSplit {
+  std::size_t threads = 0;         // 0 means std::thread::hardware_concurrency
+  std::size_t min_chunk = 1 << 16; // smaller inputs are parsed sequentially
+  string_view open = "";           // e.g. "[{("
+  string_view close = "";          // closing byte for each opening one
+  char quote = 0;
+  char escape = '\\';
+};
+
+namespace parallel {
+
+// start of every chunk: 0, then the byte after a chosen separator
+inline std::vector<std::size_t> splitPoints(string_view str, char sep,
+                                            std::size_t chunks,
+                                            const ParallelSplit &opts) {
+  std::vector<std::size_t> points{0};
+  std::size_t step = str.size() / chunks;
+  if (opts.open.empty() && opts.quote == 0) {
+    for (std::size_t i = 1; i < chunks; i++) {
+      std::size_t from = std::max(i * step, points.back());
+      const void *hit = std::memchr(str.data() + from, sep, str.size() - from);
+      if (hit == nullptr)
+        break;
+      std::size_t at = static_cast<const char *>(hit) - str.data();
+      if (at + 1 < str.size())
+        points.push_back(at + 1);
+    }
+    return points;
+  }
+
+  std::size_t depth = 0;
+  bool quoted = false;
+  for (std::size_t i = 0; i < str.size(); i++) {
+    char c = str[i];
+    if (quoted) {
+      if (c == opts.escape)
+        i++;
+      else if (c == opts.quote)
+        quoted = false;
+    } else if (c == opts.quote) {
+      quoted = true;
+    } else if (opts.open.find(c) != string_view::npos) {
+      depth++;
+    } else if (depth > 0 && opts.close.find(c) != string_view::npos) {
+      depth--;
+    } else if (c == sep && depth == 0 && i >= points.size() * step &&
+               i + 1 < str.size()) {
+      points.push_back(i + 1);
+      if (points.size() == chunks)
+        break;
+    }
+  }
+  return points;
+}
+
+} // namespace parallel
+
+namespace Parsers {
+
+// Same result as sepBy(separatee, Character(sep)), with the input split at
+// guessed separator positions and the pieces parsed on a pool of threads.
+// The guesses are checked: every piece except the last has to end exactly
+// where the next one starts, with the separatee it ends on parsed against
+// the whole rest of the input. If a guess was wrong, the input is parsed
+// sequentially from the first wrong piece on. separatee runs on other
+// threads, so it must not rely on ParseContext::current(). A budget of the
+// running ParseContext applies there too, every thread gets the steps left
+// and they are added up afterwards. The heatmap and memory resource are not
+// shared with the other threads, as neither is thread-safe.
+template <typename A>
+Parser<std::vector<A>> parallelSepBy(const Parser<A> &separatee, char sep,
+                                     ParallelSplit opts = {}) {
+  return Parser<std::vector<A>>(
+      [separatee, sep, opts](string_view str)
+          -> std::optional<std::pair<std::vector<A>, string_view>> {
+        auto sequential = sepBy(separatee, Character(sep));
+        std::size_t threads = opts.threads;
+        if (threads == 0)
+          threads = std::thread::hardware_concurrency();
+        std::size_t chunks = std::min(
+            threads * 4, str.size() / std::max<std::size_t>(opts.min_chunk, 1));
+        if (threads < 2 || chunks < 2)
+          return sequential.parse(str);
+
+        std::vector<std::size_t> points =
+            parallel::splitPoints(str, sep, chunks, opts);
+        points.push_back(str.size());
+        std::size_t pieces = points.size() - 1;
+
+        // a piece is parsed from its start to the end of the input and has
+        // to stop right at the separator before the next piece
+        std::vector<std::vector<A>> results(pieces);
+        std::vector<char> valid(pieces, false);
+        auto guessPiece = [&](std::size_t i) {
+          string_view rest = str.substr(points[i]);
+          const char *end = str.data() + points[i + 1] - (i + 1 < pieces);
+          auto item = separatee.parse(rest);
+          if (!item.has_value())
+            return;
+          while (true) {
+            results[i].push_back(std::move(item.value().first));
+            rest = item.value().second;
+            if (rest.data() == end || rest.empty())
+              break;
+            if (std::less<const char *>{}(end, rest.data()) || rest[0] != sep)
+              return;
+            item = separatee.parse(rest.substr(1));
+            if (!item.has_value())
+              return;
+          }
+          valid[i] = rest.data() == end;
+        };
+        // A wrong guess can start in the middle of an item, where separatee
+        // may throw (e.g. PosNum on the tail of a long number). The piece
+        // is invalid then, and the sequential parse from it raises the
+        // error if there really is one. Running out of budget is final.
+        auto parsePiece = [&](std::size_t i) {
+          try {
+            guessPiece(i);
+          } catch (const BudgetExceeded &) {
+            throw;
+          } catch (...) {
+            valid[i] = false;
+          }
+        };
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::atomic_flag failed;
+        auto worker = [&](budget::Meter *meter) {
+          budget::meter = meter;
+          for (std::size_t i; (i = next.fetch_add(1)) < pieces;) {
+            try {
+              parsePiece(i);
+            } catch (...) {
+              if (!failed.test_and_set())
+                error = std::current_exception();
+              next = pieces;
+            }
+          }
+        };
+        budget::Meter *caller = budget::meter;
+        std::vector<budget::Meter> meters(std::min(threads, pieces) - 1);
+        std::vector<std::thread> pool;
+        for (auto &meter : meters) {
+          if (caller != nullptr)
+            meter = caller->fork();
+          pool.emplace_back(worker, caller != nullptr ? &meter : nullptr);
+        }
+        worker(caller);
+        for (auto &t : pool)
+          t.join();
+        if (error)
+          std::rethrow_exception(error);
+        if (caller != nullptr)
+          for (const auto &meter : meters)
+            caller->merge(meter);
+
+        std::vector<A> final_res;
+        std::size_t i = 0;
+        for (; i < pieces && valid[i]; i++)
+          std::move(results[i].begin(), results[i].end(),
+                    std::back_inserter(final_res));
+        if (i == pieces)
+          return std::make_optional(
+              std::make_pair(std::move(final_res), str.substr(str.size())));
+        if (i == 0)
+          return sequential.parse(str);
+
+        // wrong guess at piece i, but everything before it holds and ends
+        // on a separator, after which a separatee is required
+        auto more = sequential.parse(str.substr(points[i]));
+        if (!more.has_value() || more.value().first.empty())
+          return std::nullopt;
+        std::move(more.value().first.begin(), more.value().first.end(),
+                  std::back_inserter(final_res));
+        return std::make_optional(
+            std::make_pair(std::move(final_res), more.value().second));
+      });
+}
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
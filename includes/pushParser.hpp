@@ -0,0 +1,159 @@
+#ifndef PUSHPARSERHPP
+#define PUSHPARSERHPP
+
+#include "Parser.hpp"
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <string>
+
+namespace cpparsec {
+
+// Runs a grammar over input that arrives in chunks. The parsing loop is a
+// coroutine that suspends whenever the buffered bytes can't hold a complete
+// item yet and is resumed by feed(). Completed items are queued for next().
+//
+// An item is complete once it is followed by unconsumed input (or the input
+// has ended). Without a delimiter a failed attempt is only retried once the
+// buffer has doubled, so a large item costs amortized linear time. With a
+// delimiter the new bytes are scanned once and the grammar only runs when the
+// delimiter has arrived. Consumed input is dropped, so memory stays bounded
+// by the largest item, and by max_buffered in any case. A ParseError from a
+// commit point counts as a failed attempt, since the item may just be
+// incomplete.
+template <typename T> class PushParser {
+public:
+  enum class Status { NeedInput, Done, Error };
+
+  explicit PushParser(Parser<T> grammar,
+                      std::optional<char> delimiter = std::nullopt,
+                      std::size_t max_buffered = 1 << 20)
+      : grammar(std::move(grammar)), delimiter(delimiter),
+        max_buffered(max_buffered), task(run()) {}
+  PushParser(const PushParser &) = delete;
+  PushParser &operator=(const PushParser &) = delete;
+  ~PushParser() { task.handle.destroy(); }
+
+  Status feed(string_view bytes) {
+    if (state != Status::NeedInput)
+      return state;
+    buffer.append(bytes);
+    return resume();
+  }
+
+  // marks the end of input, the rest of the buffer has to form whole items
+  Status finish() {
+    if (state != Status::NeedInput)
+      return state;
+    eof = true;
+    return resume();
+  }
+
+  std::optional<T> next() {
+    if (results.empty())
+      return std::nullopt;
+    T res = std::move(results.front());
+    results.pop_front();
+    return res;
+  }
+
+  Status status() const { return state; }
+  std::size_t buffered() const { return buffer.size() - start; }
+
+private:
+  struct Task {
+    struct promise_type {
+      Task get_return_object() {
+        return {std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { error = std::current_exception(); }
+      std::exception_ptr error;
+    };
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  Parser<T> grammar;
+  std::optional<char> delimiter;
+  std::size_t max_buffered;
+  std::string buffer;
+  std::size_t start = 0; // consumed prefix of buffer
+  bool eof = false;
+  Status state = Status::NeedInput;
+  std::deque<T> results;
+  Task task;
+
+  Status resume() {
+    task.handle.resume();
+    if (task.handle.promise().error) {
+      state = Status::Error;
+      std::rethrow_exception(task.handle.promise().error);
+    }
+    return state;
+  }
+
+  void consume(std::size_t n) {
+    start += n;
+    if (start * 2 >= buffer.size()) {
+      buffer.erase(0, start);
+      start = 0;
+    }
+  }
+
+  Task run() {
+    std::size_t tried = 0;   // size of the last failed attempt
+    std::size_t scanned = 0; // no delimiter before this offset
+    while (true) {
+      string_view view(buffer.data() + start, buffer.size() - start);
+      bool attempt = eof;
+      if (!attempt && delimiter.has_value()) {
+        auto pos = view.find(delimiter.value(), scanned);
+        scanned = (pos == string_view::npos) ? view.size() : pos;
+        attempt = pos != string_view::npos;
+      } else if (!attempt) {
+        attempt = view.size() >= 2 * tried;
+      }
+
+      if (attempt && !view.empty()) {
+        std::optional<std::pair<T, string_view>> res;
+        try {
+          res = grammar.parse(view);
+        } catch (const ParseError &) {
+          // may just be cut short, handled like any failed attempt
+        }
+        std::size_t consumed =
+            res.has_value() ? view.size() - res.value().second.size() : 0;
+        bool framed = delimiter.has_value() || eof;
+        if (consumed > 0 && (consumed < view.size() || framed)) {
+          results.push_back(std::move(res.value().first));
+          consume(consumed);
+          tried = scanned = 0;
+          continue;
+        }
+        // the item is framed or the input is over, more bytes can't help
+        if (framed) {
+          state = Status::Error;
+          co_return;
+        }
+        tried = view.size();
+      }
+
+      if (eof) {
+        state = Status::Done;
+        co_return;
+      }
+      if (view.size() > max_buffered) {
+        state = Status::Error;
+        co_return;
+      }
+      co_await std::suspend_always{};
+    }
+  }
+};
+
+} // namespace cpparsec
+
+#endif
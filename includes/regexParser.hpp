@@ -0,0 +1,90 @@
+#ifndef REGEXPARSERHPP
+#define REGEXPARSERHPP
+
+#include "automaton.hpp"
+#include "buildExpr.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+// op_names of the regex operator table, see regexTable()
+struct RegexOps {
+  std::string alternate = "Alternate";
+  std::string concat = "Concat";
+  std::string kleene = "Kleene";
+};
+
+// The regex grammar from main.cpp: `|` alternation, `.` concatenation and a
+// postfix `*`, with single letters as atoms
+inline std::vector<ExprType> regexTable() {
+  return {INFIX("|", "Alternate", Assoc::Left),
+          INFIX(".", "Concat", Assoc::Left),
+          POSTFIX("*", "Kleene", Assoc::Right)};
+}
+
+inline Nfa::Fragment regexToNfa(const Expr<char> &expr, Nfa &nfa,
+                                const RegexOps &ops = {}) {
+  return std::visit(
+      [&](const auto &x) -> Nfa::Fragment {
+        using U = std::decay_t<decltype(x)>;
+        if constexpr (std::is_same_v<U, InfixOperation<char>>) {
+          auto lhs = regexToNfa(*x.lhs, nfa, ops);
+          auto rhs = regexToNfa(*x.rhs, nfa, ops);
+          if (x.type == ops.alternate)
+            return nfa.alternate(lhs, rhs);
+          if (x.type == ops.concat)
+            return nfa.concat(lhs, rhs);
+          throw std::runtime_error("Unknown regex operation " + x.type);
+        } else if constexpr (std::is_same_v<U, PrefixOperation<char>> ||
+                             std::is_same_v<U, PostfixOperation<char>>) {
+          if (x.type == ops.kleene)
+            return nfa.star(regexToNfa(*x.a, nfa, ops));
+          throw std::runtime_error("Unknown regex operation " + x.type);
+        } else {
+          return nfa.chars(charSetOf(static_cast<unsigned char>(x)));
+        }
+      },
+      expr.tree);
+}
+
+inline Dfa compileRegex(const Expr<char> &expr, const RegexOps &ops = {}) {
+  Nfa nfa;
+  auto frag = regexToNfa(expr, nfa, ops);
+  return Dfa::from(nfa, frag);
+}
+
+namespace cpparsec::Parsers {
+
+// Parser for the longest prefix matched by the compiled regex
+inline Parser<string_view> Regex(std::shared_ptr<const Dfa> dfa) {
+  return Parser<string_view>(
+      [dfa = std::move(dfa)](string_view str)
+          -> std::optional<std::pair<string_view, string_view>> {
+        auto len = dfa->longest_match(str);
+        if (len == string_view::npos)
+          return std::nullopt;
+        return std::make_pair(str.substr(0, len), str.substr(len));
+      });
+}
+
+inline Parser<string_view> Regex(const Expr<char> &expr,
+                                 const RegexOps &ops = {}) {
+  return Regex(std::make_shared<const Dfa>(compileRegex(expr, ops)));
+}
+
+// throws when the pattern isn't a valid regex of regexTable()
+inline Parser<string_view> Regex(string_view pattern) {
+  auto table = regexTable();
+  auto expr = buildExpr<char>(table, Alpha, pattern);
+  if (!expr.has_value() || !expr.value().second.empty())
+    throw std::runtime_error("Invalid regex");
+  return Regex(expr.value().first);
+}
+
+inline Parser<string_view> Regex(const char *pattern) {
+  return Regex(string_view(pattern));
+}
+
+} // namespace cpparsec::Parsers
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef SEARCHHPP
+#define SEARCHHPP
+
+#include "Parser.hpp"
+#include "automaton.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cpparsec {
+
+// Scanning for the next interesting byte without running a parser per
+// position. Sets of up to four bytes, or all bytes but up to four, are
+// compared 16 bytes at a time with SSE2, a single byte goes to memchr.
+namespace search {
+
+class ByteFinder {
+public:
+  explicit ByteFinder(const CharSet &set) : table(set) {
+    bool negate = set.count() > 256 - max_bytes;
+    CharSet listed = negate ? ~set : set;
+    if (listed.count() > max_bytes)
+      return;
+    mode = negate ? Mode::AllBut : Mode::AnyOf;
+    for (int c = 0; c < 256; c++)
+      if (listed.test(c))
+        bytes[size++] = static_cast<char>(c);
+  }
+
+  // offset of the first byte of str in the set, or npos
+  std::size_t find(string_view str) const {
+    if (mode == Mode::AnyOf && size == 1) {
+      const void *hit = std::memchr(str.data(), bytes[0], str.size());
+      return hit == nullptr ? string_view::npos
+                            : static_cast<const char *>(hit) - str.data();
+    }
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    if (mode != Mode::Table) {
+      for (; i + 16 <= str.size(); i += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i));
+        __m128i hits = _mm_setzero_si128();
+        for (std::size_t b = 0; b < size; b++)
+          hits = _mm_or_si128(hits,
+                              _mm_cmpeq_epi8(chunk, _mm_set1_epi8(bytes[b])));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mode == Mode::AllBut)
+          mask ^= 0xffff;
+        if (mask != 0)
+          return i + std::countr_zero(mask);
+      }
+    }
+#endif
+    for (; i < str.size(); i++)
+      if (table.test(static_cast<unsigned char>(str[i])))
+        return i;
+    return string_view::npos;
+  }
+
+private:
+  static constexpr std::size_t max_bytes = 4;
+  enum class Mode { Table, AnyOf, AllBut };
+  CharSet table;
+  Mode mode = Mode::Table;
+  std::array<char, max_bytes> bytes{};
+  std::size_t size = 0;
+};
+
+// offset of the first occurrence of literal in str, or npos. Candidates
+// are found with memchr on the first byte of literal.
+inline std::size_t find(string_view str, string_view literal) {
+  if (literal.empty())
+    return 0;
+  std::size_t i = 0;
+  while (i + literal.size() <= str.size()) {
+    const void *hit = std::memchr(str.data() + i, literal[0],
+                                  str.size() - literal.size() + 1 - i);
+    if (hit == nullptr)
+      break;
+    i = static_cast<const char *>(hit) - str.data();
+    if (std::memcmp(str.data() + i + 1, literal.data() + 1,
+                    literal.size() - 1) == 0)
+      return i;
+    i++;
+  }
+  return string_view::npos;
+}
+
+} // namespace search
+
+namespace Parsers {
+
+// everything up to the next occurrence of literal, which is left in the
+// input. Fails if literal doesn't occur.
+inline Parser<string_view> searchFor(std::string literal) {
+  return Parser<string_view>(
+      [literal = std::move(literal)](string_view str)
+          -> std::optional<std::pair<string_view, string_view>> {
+        std::size_t at = search::find(str, literal);
+        heat::examined(str, at == string_view::npos ? str.size()
+                                                    : at + literal.size());
+        if (at == string_view::npos)
+          return std::nullopt;
+        return std::make_pair(str.substr(0, at), str.substr(at));
+      });
+}
+
+// Skips input up to the first position where parser matches and gives its
+// value. parser is only tried where the next byte is in first, so with the
+// bytes its matches can start with (see Grammar::first) the input in
+// between is skipped at memory speed. Without first it is tried at every
+// byte. At the end of the input it is always tried, for parsers that match
+// the empty string.
+template <typename T>
+Parser<T> skipUntil(const Parser<T> &parser,
+                    const CharSet &first = ~CharSet()) {
+  return Parser<T>(
+      [parser, finder = search::ByteFinder(first)](
+          string_view str) -> std::optional<std::pair<T, string_view>> {
+        while (true) {
+          std::size_t at = finder.find(str);
+          heat::examined(str, at == string_view::npos ? str.size() : at);
+          if (at == string_view::npos) // no byte to go by at the end
+            return parser.parse(str.substr(str.size()));
+          str.remove_prefix(at);
+          auto res = parser.parse(str);
+          RETURN_OPT_IF_HAS_VALUE(res);
+          str.remove_prefix(1);
+        }
+      });
+}
+
+// parser repeatedly until end matches, end is consumed and its value
+// dropped. end is only tried where the input starts with a byte of
+// end_first, elsewhere parser runs right away. Use searchFor when the items
+// are plain bytes.
+template <typename T, typename E>
+Parser<std::vector<T>> manyTill(const Parser<T> &parser, const Parser<E> &end,
+                                const CharSet &end_first = ~CharSet()) {
+  return Parser<std::vector<T>>(
+      [parser, end, end_first](string_view str)
+          -> std::optional<std::pair<std::vector<T>, string_view>> {
+        std::vector<T> items;
+        while (true) {
+          if (str.empty() ||
+              end_first.test(static_cast<unsigned char>(str[0]))) {
+            auto done = end.parse(str);
+            if (done.has_value())
+              return std::make_pair(std::move(items), done.value().second);
+          }
+          auto item = parser.parse(str);
+          RETURN_NULLOPT_IF_NO_VALUE(item);
+          items.push_back(std::move(item.value().first));
+          str = item.value().second;
+        }
+      });
+}
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SINKSHPP
+#define SINKSHPP
+
+#include "Parser.hpp"
+
+#include <concepts>
+
+// Sequence parsers that hand every item to a sink instead of collecting them
+// into a std::vector. With Columns the fields of each record are moved
+// straight into caller-owned column vectors:
+//
+//   std::vector<size_t> ids;
+//   std::vector<char> tags;
+//   auto rows = sepByInto(zip(PosNum, Alpha), Character(','),
+//                         Columns(ids, tags));
+//
+// The parsers yield the number of items written. A sink only has to support
+// push, size and truncate. When sepByInto fails it truncates what it wrote,
+// items written by a run that succeeded stay even if an enclosing parser
+// backtracks afterwards.
+//
+// Every run works on its own copy of sink, so a sink should refer to its
+// storage like Columns does. The parser refers to that storage, so unlike
+// other parsers it must not be run from several threads at once.
+namespace cpparsec {
+
+template <typename S, typename T>
+concept SinkFor = requires(S sink, T item, std::size_t n) {
+  sink.push(std::move(item));
+  { sink.size() } -> std::convertible_to<std::size_t>;
+  sink.truncate(n);
+};
+
+// one vector per tuple element, or a single vector for non tuple items
+template <typename... Ts> class Columns {
+public:
+  explicit Columns(std::vector<Ts> &...columns) : columns(&columns...) {}
+
+  void push(std::tuple<Ts...> &&row) {
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (std::get<I>(columns)->push_back(std::move(std::get<I>(row))), ...);
+    }(std::index_sequence_for<Ts...>());
+  }
+  void push(Ts &&...fields) requires(sizeof...(Ts) == 1) {
+    (std::get<0>(columns)->push_back(std::move(fields)), ...);
+  }
+
+  std::size_t size() const { return std::get<0>(columns)->size(); }
+  void truncate(std::size_t n) {
+    std::apply([n](auto *...col) { (col->resize(n), ...); }, columns);
+  }
+  void reserve(std::size_t n) {
+    std::apply([n](auto *...col) { (col->reserve(n), ...); }, columns);
+  }
+
+private:
+  std::tuple<std::vector<Ts> *...> columns;
+};
+
+namespace Parsers {
+
+template <typename A, SinkFor<A> S>
+Parser<size_t> zeroOrMoreInto(const Parser<A> &parser, S sink) {
+  return Parser<size_t>([parser, sink](string_view str) {
+    S out = sink;
+    std::size_t count = 0;
+    auto res = parser.parse(str);
+    while (res.has_value()) {
+      out.push(std::move(res.value().first));
+      count++;
+      str = res.value().second;
+      res = parser.parse(str);
+    }
+    cut::checkRewind(str);
+    return std::make_optional(std::make_pair(count, str));
+  });
+}
+
+template <typename A, SinkFor<A> S>
+Parser<size_t> oneOrMoreInto(const Parser<A> &parser, S sink) {
+  return zeroOrMoreInto(parser, sink).filter([](size_t n) { return n > 0; });
+}
+
+// same matching rules as sepBy
+template <typename A, typename B, SinkFor<A> S>
+Parser<size_t> sepByInto(const Parser<A> &separatee, const Parser<B> &separator,
+                         S sink) {
+  return Parser<size_t>([separatee, separator, sink](string_view str)
+                            -> std::optional<std::pair<size_t, string_view>> {
+    S out = sink;
+    std::size_t start = out.size();
+    auto item = separatee.parse(str);
+    if (!item.has_value())
+      return std::make_pair(std::size_t(0), str);
+    while (true) {
+      out.push(std::move(item.value().first));
+      str = item.value().second;
+      if (str.empty())
+        break;
+      auto sep = separator.parse(str);
+      if (sep.has_value())
+        item = separatee.parse(sep.value().second);
+      if (!sep.has_value() || !item.has_value()) {
+        out.truncate(start);
+        return std::nullopt;
+      }
+    }
+    return std::make_pair(out.size() - start, str);
+  });
+}
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef STACKSAFEHPP
+#define STACKSAFEHPP
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// Recursive rules (Parsers::lazy, buildExpr) run through growStack. While
+// there is enough native stack left that is a plain call. Once the stack runs
+// low the call continues on a fresh heap-allocated segment, so nesting depth
+// is only limited by memory. Define CPPARSEC_NO_STACK_GROWTH to opt out.
+#if !defined(CPPARSEC_NO_STACK_GROWTH) && __has_include(<ucontext.h>) &&     \
+    __has_include(<pthread.h>)
+#define CPPARSEC_STACK_GROWTH 1
+#include <pthread.h>
+#include <ucontext.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#endif
+#if defined(__SANITIZE_THREAD__)
+#include <sanitizer/tsan_interface.h>
+#endif
+
+namespace cpparsec::stack {
+
+// switch to a new segment when less than this is left
+inline constexpr std::size_t red_zone = 256 * 1024;
+inline constexpr std::size_t segment_size = 8 * 1024 * 1024;
+inline constexpr std::size_t max_spare_segments = 2;
+
+#ifdef CPPARSEC_STACK_GROWTH
+
+struct ThreadStack {
+  const char *limit = nullptr; // lowest usable address of the current stack
+  std::vector<std::unique_ptr<char[]>> spare; // released segments, reused
+};
+
+inline ThreadStack &threadStack() {
+  thread_local ThreadStack state;
+  if (state.limit == nullptr) {
+    pthread_attr_t attr;
+    void *addr = nullptr;
+    std::size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+      pthread_attr_getstack(&attr, &addr, &size);
+      pthread_attr_destroy(&attr);
+    }
+    state.limit = static_cast<const char *>(addr);
+  }
+  return state;
+}
+
+inline bool nearlyExhausted() {
+  const char *here = static_cast<const char *>(__builtin_frame_address(0));
+  return static_cast<std::size_t>(here - threadStack().limit) < red_zone;
+}
+
+struct Switch {
+  ucontext_t caller, callee;
+  void (*body)(Switch &);
+  void *fn;
+  void *result;
+  std::exception_ptr error;
+  const void *caller_bottom = nullptr; // for the sanitizer
+  std::size_t caller_size = 0;
+  void *fake_stack = nullptr;
+  void *caller_fiber = nullptr;
+};
+
+inline thread_local Switch *pending = nullptr;
+
+inline void trampoline() {
+  Switch &sw = *pending;
+#if defined(__SANITIZE_ADDRESS__)
+  __sanitizer_finish_switch_fiber(nullptr, &sw.caller_bottom, &sw.caller_size);
+#endif
+  try {
+    sw.body(sw);
+  } catch (...) {
+    sw.error = std::current_exception();
+  }
+#if defined(__SANITIZE_ADDRESS__)
+  __sanitizer_start_switch_fiber(nullptr, sw.caller_bottom, sw.caller_size);
+#endif
+#if defined(__SANITIZE_THREAD__)
+  __tsan_switch_to_fiber(sw.caller_fiber, 0);
+#endif
+  swapcontext(&sw.callee, &sw.caller);
+}
+
+// getcontext counts as returning twice, so it's kept out of frames whose
+// locals must survive the switch
+[[gnu::noinline]] inline void prepare(Switch &sw, char *segment) {
+  getcontext(&sw.callee);
+  sw.callee.uc_stack.ss_sp = segment;
+  sw.callee.uc_stack.ss_size = segment_size;
+  sw.callee.uc_link = nullptr;
+  makecontext(&sw.callee, trampoline, 0);
+}
+
+template <typename F> auto onNewSegment(F &fn) -> std::invoke_result_t<F &> {
+  using R = std::invoke_result_t<F &>;
+  ThreadStack &state = threadStack();
+  std::unique_ptr<char[]> segment;
+  if (state.spare.empty()) {
+    segment.reset(new char[segment_size]);
+  } else {
+    segment = std::move(state.spare.back());
+    state.spare.pop_back();
+  }
+
+  std::optional<R> result;
+  Switch sw;
+  sw.fn = &fn;
+  sw.result = &result;
+  sw.body = [](Switch &s) {
+    static_cast<std::optional<R> *>(s.result)
+        ->emplace((*static_cast<F *>(s.fn))());
+  };
+  prepare(sw, segment.get());
+
+  const char *outer_limit = state.limit;
+  state.limit = segment.get();
+  pending = &sw;
+#if defined(__SANITIZE_ADDRESS__)
+  __sanitizer_start_switch_fiber(&sw.fake_stack, segment.get(), segment_size);
+#endif
+#if defined(__SANITIZE_THREAD__)
+  sw.caller_fiber = __tsan_get_current_fiber();
+  void *fiber = __tsan_create_fiber(0);
+  __tsan_switch_to_fiber(fiber, 0);
+#endif
+  swapcontext(&sw.caller, &sw.callee);
+#if defined(__SANITIZE_ADDRESS__)
+  __sanitizer_finish_switch_fiber(sw.fake_stack, nullptr, nullptr);
+#endif
+#if defined(__SANITIZE_THREAD__)
+  __tsan_destroy_fiber(fiber);
+#endif
+  state.limit = outer_limit;
+  if (state.spare.size() < max_spare_segments)
+    state.spare.push_back(std::move(segment));
+
+  if (sw.error)
+    std::rethrow_exception(sw.error);
+  return std::move(result.value());
+}
+
+#else
+
+inline bool nearlyExhausted() { return false; }
+template <typename F> auto onNewSegment(F &fn) { return fn(); }
+
+#endif
+
+} // namespace cpparsec::stack
+
+namespace cpparsec {
+
+// calls fn, on a new stack segment if the current one is nearly used up
+template <typename F> auto growStack(F &&fn) {
+  if (stack::nearlyExhausted())
+    return stack::onNewSegment(fn);
+  return fn();
+}
+
+} // namespace cpparsec
+
+#endif
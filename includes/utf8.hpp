@@ -0,0 +1,229 @@
+#ifndef UTF8HPP
+#define UTF8HPP
+
+#include "Parser.hpp"
+#include "unicodeTables.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cpparsec {
+
+// Decoding and validation of UTF-8 input. ASCII is never decoded: runs of it
+// are skipped 16 bytes at a time where SSE2 is available, and the parsers
+// below only decode when a byte has its high bit set.
+namespace utf8 {
+
+// length of the all-ASCII prefix of str
+inline std::size_t asciiPrefix(string_view str) {
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= str.size(); i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(chunk));
+    if (mask != 0)
+      return i + std::countr_zero(mask);
+  }
+#endif
+  while (i < str.size() && static_cast<unsigned char>(str[i]) < 0x80)
+    i++;
+  return i;
+}
+
+struct Decoded {
+  char32_t code_point;
+  std::size_t size; // bytes
+};
+
+// The code point str starts with. Overlong forms, surrogates, values past
+// U+10FFFF and truncated sequences are malformed and give std::nullopt.
+inline std::optional<Decoded> decode(string_view str) {
+  if (str.empty())
+    return std::nullopt;
+  auto byte = [&](std::size_t i) { return static_cast<unsigned char>(str[i]); };
+  if (byte(0) < 0x80)
+    return Decoded{byte(0), 1};
+
+  std::size_t size;
+  char32_t cp, min;
+  if (byte(0) >= 0xc2 && byte(0) <= 0xdf) {
+    size = 2, cp = byte(0) & 0x1f, min = 0x80;
+  } else if ((byte(0) & 0xf0) == 0xe0) {
+    size = 3, cp = byte(0) & 0x0f, min = 0x800;
+  } else if (byte(0) >= 0xf0 && byte(0) <= 0xf4) {
+    size = 4, cp = byte(0) & 0x07, min = 0x10000;
+  } else {
+    return std::nullopt;
+  }
+  if (str.size() < size)
+    return std::nullopt;
+  for (std::size_t i = 1; i < size; i++) {
+    if ((byte(i) & 0xc0) != 0x80)
+      return std::nullopt;
+    cp = (cp << 6) | (byte(i) & 0x3f);
+  }
+  if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+    return std::nullopt;
+  return Decoded{cp, size};
+}
+
+inline bool valid(string_view str) {
+  while (true) {
+    str.remove_prefix(asciiPrefix(str));
+    if (str.empty())
+      return true;
+    auto decoded = decode(str);
+    if (!decoded.has_value())
+      return false;
+    str.remove_prefix(decoded->size);
+  }
+}
+
+} // namespace utf8
+
+// Character classes over code points, from the tables generated by
+// scripts/genUnicodeTables.py.
+namespace unicode {
+
+// in the order of the generated tables
+enum class Category : std::uint8_t {
+  Lu, Ll, Lt, Lm, Lo, Mn, Mc, Me, Nd, Nl, No, Pc, Pd, Ps, Pe,
+  Pi, Pf, Po, Sm, Sc, Sk, So, Zs, Zl, Zp, Cc, Cf, Cs, Co, Cn
+};
+
+inline Category category(char32_t cp) {
+  const auto &starts = tables::category_starts;
+  auto it = std::upper_bound(std::begin(starts), std::end(starts),
+                             static_cast<std::uint32_t>(cp));
+  return Category(tables::category_values[it - std::begin(starts) - 1]);
+}
+
+template <std::size_t N>
+bool inRanges(const std::uint32_t (&ranges)[N][2], char32_t cp) {
+  auto it = std::upper_bound(
+      std::begin(ranges), std::end(ranges), static_cast<std::uint32_t>(cp),
+      [](std::uint32_t x, const std::uint32_t(&range)[2]) {
+        return x < range[0];
+      });
+  return it != std::begin(ranges) && cp <= (*std::prev(it))[1];
+}
+
+inline bool isAsciiAlpha(char32_t cp) {
+  return (cp | 0x20) >= 'a' && (cp | 0x20) <= 'z';
+}
+inline bool isAsciiDigit(char32_t cp) { return cp >= '0' && cp <= '9'; }
+
+// general category L
+inline bool isLetter(char32_t cp) {
+  if (cp < 0x80)
+    return isAsciiAlpha(cp);
+  return category(cp) <= Category::Lo;
+}
+// general category Nd
+inline bool isDecimal(char32_t cp) {
+  if (cp < 0x80)
+    return isAsciiDigit(cp);
+  return category(cp) == Category::Nd;
+}
+inline bool isAlphaNum(char32_t cp) { return isLetter(cp) || isDecimal(cp); }
+// the White_Space property
+inline bool isWhiteSpace(char32_t cp) {
+  if (cp < 0x80)
+    return cp == ' ' || (cp >= '\t' && cp <= '\r');
+  return cp == 0x85 || cp == 0xa0 || cp == 0x1680 ||
+         (cp >= 0x2000 && cp <= 0x200a) || cp == 0x2028 || cp == 0x2029 ||
+         cp == 0x202f || cp == 0x205f || cp == 0x3000;
+}
+inline bool isXidStart(char32_t cp) {
+  if (cp < 0x80)
+    return isAsciiAlpha(cp);
+  return inRanges(tables::xid_start, cp);
+}
+inline bool isXidContinue(char32_t cp) {
+  if (cp < 0x80)
+    return isAsciiAlpha(cp) || isAsciiDigit(cp) || cp == '_';
+  return inRanges(tables::xid_continue, cp);
+}
+
+} // namespace unicode
+
+namespace Parsers {
+namespace primitives {
+
+inline bool anyCodePoint(char32_t) { return true; }
+
+// one code point satisfying pred, decoded only if it isn't ASCII
+template <bool (*pred)(char32_t)>
+std::optional<std::pair<char32_t, string_view>>
+codePointWhere(string_view str) {
+  if (!str.empty() && static_cast<unsigned char>(str[0]) < 0x80) {
+    if (!pred(str[0]))
+      return std::nullopt;
+    return std::make_pair(char32_t(str[0]), str.substr(1));
+  }
+  auto decoded = utf8::decode(str);
+  if (!decoded.has_value() || !pred(decoded->code_point))
+    return std::nullopt;
+  return std::make_pair(decoded->code_point, str.substr(decoded->size));
+}
+
+inline std::optional<std::pair<string_view, string_view>>
+identifier(string_view str) {
+  std::size_t i = 0;
+  bool start = true;
+  while (i < str.size()) {
+    auto byte = static_cast<unsigned char>(str[i]);
+    if (byte < 0x80) {
+      if (!(start ? unicode::isXidStart(byte) || byte == '_'
+                  : unicode::isXidContinue(byte)))
+        break;
+      i++;
+    } else {
+      auto decoded = utf8::decode(str.substr(i));
+      if (!decoded.has_value() ||
+          !(start ? unicode::isXidStart(decoded->code_point)
+                  : unicode::isXidContinue(decoded->code_point)))
+        break;
+      i += decoded->size;
+    }
+    start = false;
+  }
+  if (i == 0)
+    return std::nullopt;
+  return std::make_pair(str.substr(0, i), str.substr(i));
+}
+
+} // namespace primitives
+
+// UTF-8 counterparts of Char, Alpha, Digit, AlphaNum and WhiteSpace, giving
+// code points. Malformed UTF-8 never matches.
+inline constinit const Parser<char32_t> Utf8Char{
+    primitive(&primitives::codePointWhere<primitives::anyCodePoint>)};
+inline constinit const Parser<char32_t> Utf8Alpha{
+    primitive(&primitives::codePointWhere<unicode::isLetter>)};
+inline constinit const Parser<char32_t> Utf8Digit{
+    primitive(&primitives::codePointWhere<unicode::isDecimal>)};
+inline constinit const Parser<char32_t> Utf8AlphaNum{
+    primitive(&primitives::codePointWhere<unicode::isAlphaNum>)};
+inline constinit const Parser<char32_t> Utf8WhiteSpace{
+    primitive(&primitives::codePointWhere<unicode::isWhiteSpace>)};
+inline constinit const Parser<char32_t> XidStart{
+    primitive(&primitives::codePointWhere<unicode::isXidStart>)};
+inline constinit const Parser<char32_t> XidContinue{
+    primitive(&primitives::codePointWhere<unicode::isXidContinue>)};
+
+// XID_Start or '_', then any number of XID_Continue, as a slice of the input
+inline constinit const Parser<string_view> Identifier{
+    primitive(&primitives::identifier)};
+
+} // namespace Parsers
+} // namespace cpparsec
+
+#endif
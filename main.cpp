@@ -22,6 +22,7 @@ std::ostream &operator<<(std::ostream &out, const Atom &x) {
 #include <Parser.hpp>
 #include <buildExpr.hpp>
 #include <buildExprClassesUtils.hpp>
+#include <regexParser.hpp>
 using namespace cpparsec;
 using namespace cpparsec::Parsers;
 
@@ -58,8 +59,16 @@ void parseRegexExpr() {
   std::cout << "Tree for regex parsing of " << input << "\n";
   auto expr_parser = buildExpressionParser(table, Alpha);
   auto expr = expr_parser.parse(input);
-  if (expr.has_value())
-    std::cout << expr.value().first << '\n';
+  if (!expr.has_value())
+    return;
+  std::cout << expr.value().first << '\n';
+  auto matcher = Regex(expr.value().first);
+  for (string_view str : {"aaabb", "cc", "ddx", "x"}) {
+    auto match = matcher.parse(str);
+    std::cout << str << " -> "
+              << (match.has_value() ? match.value().first : "no match")
+              << '\n';
+  }
 }
 
 int main() {
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Generates includes/unicodeTables.hpp from Python's unicodedata.
+
+    python3 scripts/genUnicodeTables.py > includes/unicodeTables.hpp
+
+XID_Start/XID_Continue come from str.isidentifier, which Python defines by
+exactly those properties (plus '_' as a start character).
+"""
+
+import sys
+import unicodedata
+
+CATEGORIES = ["Lu", "Ll", "Lt", "Lm", "Lo", "Mn", "Mc", "Me", "Nd", "Nl",
+              "No", "Pc", "Pd", "Ps", "Pe", "Pi", "Pf", "Po", "Sm", "Sc",
+              "Sk", "So", "Zs", "Zl", "Zp", "Cc", "Cf", "Cs", "Co", "Cn"]
+MAX = 0x110000
+
+
+def category_runs():
+    runs, prev = [], None
+    for cp in range(MAX):
+        cat = unicodedata.category(chr(cp))
+        if cat != prev:
+            runs.append((cp, cat))
+            prev = cat
+    return runs
+
+
+def ranges(pred):
+    res, start = [], None
+    for cp in range(MAX + 1):
+        inside = cp < MAX and pred(chr(cp))
+        if inside and start is None:
+            start = cp
+        elif not inside and start is not None:
+            res.append((start, cp - 1))
+            start = None
+    return res
+
+
+def rows(items, per_line):
+    for i in range(0, len(items), per_line):
+        yield "    " + " ".join(items[i:i + per_line])
+
+
+def main():
+    out = sys.stdout.write
+    runs = category_runs()
+    xid_start = ranges(lambda c: c.isidentifier() and c != "_")
+    xid_continue = ranges(lambda c: ("a" + c).isidentifier())
+
+    out("// Generated by scripts/genUnicodeTables.py from Unicode %s, do not edit.\n"
+        % unicodedata.unidata_version)
+    out("#ifndef UNICODETABLESHPP\n#define UNICODETABLESHPP\n\n")
+    out("#include <cstdint>\n\nnamespace cpparsec::unicode::tables {\n\n")
+    out('inline constexpr const char *version = "%s";\n\n'
+        % unicodedata.unidata_version)
+
+    out("// general category of every code point from category_starts[i] up to\n"
+        "// the next start, as an index into Category\n")
+    out("inline constexpr std::uint32_t category_starts[] = {\n")
+    out("\n".join(rows(["0x%x," % cp for cp, _ in runs], 8)) + "\n};\n")
+    out("inline constexpr std::uint8_t category_values[] = {\n")
+    out("\n".join(rows(["%d," % CATEGORIES.index(cat) for _, cat in runs], 16))
+        + "\n};\n\n")
+
+    for name, table in (("xid_start", xid_start),
+                        ("xid_continue", xid_continue)):
+        out("// inclusive ranges, sorted\n")
+        out("inline constexpr std::uint32_t %s[][2] = {\n" % name)
+        out("\n".join(rows(["{0x%x, 0x%x}," % r for r in table], 3)) + "\n};\n")
+    out("\n} // namespace cpparsec::unicode::tables\n\n#endif\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,29 @@
+// The instantiations Parser.hpp and buildExpr.hpp declare extern when
+// CPPARSEC_EXTERN_TEMPLATES is defined, compiled once for every program
+// that links the cpparsec library.
+
+#include "Parser.hpp"
+#include "buildExpr.hpp"
+
+namespace cpparsec {
+
+template class Parser<char>;
+template class Parser<bool>;
+template class Parser<size_t>;
+template class Parser<long long>;
+template class Parser<string_view>;
+template class Parser<std::string>;
+template class Parser<std::vector<char>>;
+
+} // namespace cpparsec
+
+template struct Expr<char>;
+template struct Expr<std::string>;
+template std::optional<std::pair<Expr<char>, string_view>>
+buildExpr(std::span<ExprType>, const Parser<char> &, string_view);
+template std::optional<std::pair<Expr<std::string>, string_view>>
+buildExpr(std::span<ExprType>, const Parser<std::string> &, string_view);
+template Parser<Expr<char>> buildExpressionParser(std::span<ExprType>,
+                                                  const Parser<char> &);
+template Parser<Expr<std::string>>
+buildExpressionParser(std::span<ExprType>, const Parser<std::string> &);
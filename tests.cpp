@@ -1,8 +1,33 @@
+// operator new counts for the allocation budget tests
+#define CPPARSEC_COUNT_ALLOCATIONS
+
 #include <catch2/catch.hpp>
 
 #include "Parser.hpp"
+#include "adaptiveChoice.hpp"
+#include "allocCount.hpp"
+#include "budget.hpp"
+#include "context.hpp"
+#include "exprSerialize.hpp"
+#include "grammar.hpp"
+#include "grammarOptimizer.hpp"
+#include "hashConsExpr.hpp"
+#include "heatmap.hpp"
+#include "incrementalExpr.hpp"
+#include "memory.hpp"
+#include "parallel.hpp"
+#include "pushParser.hpp"
+#include "regexParser.hpp"
+#include "search.hpp"
+#include "sinks.hpp"
+#include "utf8.hpp"
+#include <array>
 #include <cassert>
 #include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
 
 using namespace cpparsec;
 using namespace cpparsec::Parsers;
@@ -34,6 +59,30 @@ TEST_CASE("Number") {
           std::make_pair<long long, string_view>(-123, string_view("b")));
 }
 
+TEST_CASE("Input slices") {
+  string_view input = "abc12 rest";
+  auto word = Alpha.oneOrMoreSlice().parse(input);
+  REQUIRE(word.value() ==
+          std::make_pair(string_view("abc"), string_view("12 rest")));
+  // the slice points into the input, nothing is copied
+  REQUIRE(word.value().first.data() == input.data());
+  REQUIRE(Alpha.zeroOrMoreSlice().parse("12").value().first.empty());
+  REQUIRE(!Alpha.oneOrMoreSlice().parse("12").has_value());
+
+  auto ident = recognize(zip(Alpha, AlphaNum.zeroOrMore()));
+  REQUIRE(ident.parse(input).value().first == "abc12");
+  REQUIRE(!ident.parse("1a").has_value());
+
+  auto number = matched(PosNum).parse("0042+");
+  REQUIRE(number.value().first ==
+          std::make_tuple(string_view("0042"), size_t(42)));
+  REQUIRE(number.value().second == "+");
+
+  REQUIRE(PosNum.parse("4294967296").value().first == 4294967296ULL);
+  REQUIRE_THROWS_AS(PosNum.parse("99999999999999999999999"),
+                    std::out_of_range);
+}
+
 TEST_CASE("Brackets Check") {
   auto lcurly_check = LeftCurly.parse("{)");
   REQUIRE(lcurly_check ==
@@ -128,6 +177,32 @@ TEST_CASE("Char Template Specialization") {
           std::pair<bool, string_view>(true, "1"));
 }
 
+TEST_CASE("Empty parser") {
+  // like an empty std::function, a default constructed parser throws
+  Parser<char> empty;
+  REQUIRE(!empty.parse);
+  REQUIRE_THROWS_AS(empty.parse("x"), std::bad_function_call);
+}
+
+TEST_CASE("Copies share the callable") {
+  // copies of a parser share one callable, so state it mutates would leak
+  // between them and between threads
+  auto counter = [n = 0](string_view str) mutable
+      -> std::optional<std::pair<int, string_view>> {
+    return std::make_pair(++n, str);
+  };
+  STATIC_REQUIRE(!std::constructible_from<Parser<int>, decltype(counter)>);
+
+  auto calls = std::make_shared<int>(0);
+  Parser<int> counting([calls](string_view str)
+                           -> std::optional<std::pair<int, string_view>> {
+    return std::make_pair(++*calls, str);
+  });
+  auto copy = counting;
+  REQUIRE(counting.parse("").value().first == 1);
+  REQUIRE(copy.parse("").value().first == 2);
+}
+
 TEST_CASE("Character Parsers") {
   auto excludes1 = Char_excluding(']').parse("]Hi");
   REQUIRE(!excludes1.has_value());
@@ -215,3 +290,988 @@ TEST_CASE("SepBy Checks") {
   REQUIRE(sepby1_check.value().first == std::vector<char>{'a', 'b'});
   REQUIRE(sepby1_check.value().second == "");
 }
+
+TEST_CASE("Hash-consed Expr") {
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left)};
+  ExprInterner<char> interner;
+  auto parser = buildHashConsedExpressionParser(table, Digit, interner);
+
+  auto first = parser.parse("1*2+1*2+1*2");
+  REQUIRE(first.has_value());
+  REQUIRE(first.value().second == "");
+  // 1, 2, 1*2, (1*2+1*2), ((1*2+1*2)+1*2)
+  REQUIRE(interner.size() == 5);
+
+  auto same = parser.parse("1*2+1*2+1*2");
+  REQUIRE(same.value().first == first.value().first);
+  REQUIRE(interner.size() == 5);
+
+  const auto *root = first.value().first;
+  REQUIRE(root->op == "Add");
+  REQUIRE(root->lhs->rhs == root->rhs);
+
+  // identical to the tree buildExpr gives
+  std::ostringstream from_dag, from_tree;
+  from_dag << ExprInterner<char>::to_expr(root);
+  from_tree << buildExpr(table, Digit, "1*2+1*2+1*2").value().first;
+  REQUIRE(from_dag.str() == from_tree.str());
+  REQUIRE(interner.intern(buildExpr(table, Digit, "1*2").value().first) ==
+          root->rhs);
+
+  MemoEvaluator<char, int> eval(
+      [](const ExprNode<char> &node, auto &self) -> int {
+        if (node.is_leaf())
+          return node.leaf - '0';
+        return node.op == "Add" ? self(node.lhs) + self(node.rhs)
+                                : self(node.lhs) * self(node.rhs);
+      });
+  REQUIRE(eval(root) == 6);
+  REQUIRE(eval.evaluations() == 5);
+}
+
+TEST_CASE("Regex DFA") {
+  auto regex = Regex("a*.b*|c*|d*");
+  auto match = regex.parse("aaabbc");
+  REQUIRE(match.has_value());
+  REQUIRE(match.value() == std::pair<string_view, string_view>("aaabb", "c"));
+
+  match = regex.parse("ccd");
+  REQUIRE(match.value() == std::pair<string_view, string_view>("cc", "d"));
+
+  // every branch accepts the empty string
+  match = regex.parse("x");
+  REQUIRE(match.value() == std::pair<string_view, string_view>("", "x"));
+
+  match = Regex("a.b.c*").parse("ab");
+  REQUIRE(match.value() == std::pair<string_view, string_view>("ab", ""));
+  REQUIRE(!Regex("a.b.c*").parse("a").has_value());
+  REQUIRE(!Regex("a.b.c*").parse("ba").has_value());
+
+  // a*.a* minimizes to a looping start state plus the dead state
+  auto table = regexTable();
+  auto expr = buildExpr<char>(table, Alpha, "a*.a*").value().first;
+  REQUIRE(compileRegex(expr).size() == 2);
+
+  REQUIRE_THROWS(Regex("a.|"));
+}
+
+TEST_CASE("Compiling regular combinators") {
+  namespace G = cpparsec::Grammar;
+  auto ident = G::Alpha.andThen(G::oneOf(G::Character('_'), G::Digit,
+                                         G::Alpha)
+                                    .zeroOrMore());
+  auto compiled = G::compile(ident);
+  REQUIRE(compiled.uncompiled.empty());
+  auto res = compiled.parser.parse("ab_1 = 2");
+  REQUIRE(res.value() == std::pair<string_view, string_view>("ab_1", " = 2"));
+  REQUIRE(!compiled.parser.parse("1ab").has_value());
+  // the classes agree with the Parsers primitives on every byte
+  for (int c = 0; c < 256; c++) {
+    char ch = static_cast<char>(c);
+    REQUIRE(G::first(G::Alpha).test(c) == Parsers::primitives::alpha(ch));
+    REQUIRE(G::first(G::AlphaNum).test(c) ==
+            Parsers::primitives::alphaNum(ch));
+  }
+  REQUIRE(G::first(G::Digit).count() == 10);
+
+  auto excluding = G::compile(
+      G::Char_excluding_many(std::array{'[', ']'}).zeroOrMore());
+  REQUIRE(excluding.parser.parse("ab[c").value().first == "ab");
+
+  // the loop would eat the final 'a' the combinators need, so it stays as is
+  auto greedy = G::compile(G::Alpha.oneOrMore().andThen(G::Character('a')));
+  REQUIRE(greedy.uncompiled.size() == 1);
+  REQUIRE(!greedy.parser.parse("aa").has_value());
+  REQUIRE(!Alpha.oneOrMore().andThen(Character('a')).parse("aa").has_value());
+
+  // opaque parsers run as they are, the regular parts around them compile
+  auto mixed = G::compile(G::zipMany(G::String("let"), G::WhiteSpace,
+                                     G::Opaque("PosNum", PosNum),
+                                     G::Digit.zeroOrMore()));
+  REQUIRE(mixed.uncompiled ==
+          std::vector<std::string>{"Opaque(PosNum): not a regular combinator"});
+  REQUIRE(mixed.parser.parse("let 12;").value() ==
+          std::pair<string_view, string_view>("let 12", ";"));
+}
+
+TEST_CASE("Push parser over a socketpair") {
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  // records split at awkward places, written one chunk at a time
+  std::thread writer([fd = fds[1]] {
+    std::string input;
+    for (int i = 0; i < 200; i++)
+      input += "rec" + std::to_string(i) + ";";
+    for (std::size_t i = 0; i < input.size(); i += 7) {
+      auto chunk = input.substr(i, 7);
+      if (write(fd, chunk.data(), chunk.size()) < 0)
+        break;
+    }
+    close(fd);
+  });
+
+  auto record = zipAndGet<0>(AlphaNum.oneOrMore(), Character(';'));
+  PushParser<std::vector<char>> push(record, ';', 64);
+  std::vector<std::string> records;
+  char buf[16];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+    REQUIRE(push.feed(string_view(buf, n)) ==
+            PushParser<std::vector<char>>::Status::NeedInput);
+    REQUIRE(push.buffered() <= 64);
+    while (auto rec = push.next())
+      records.emplace_back(rec->begin(), rec->end());
+  }
+  REQUIRE(push.finish() == PushParser<std::vector<char>>::Status::Done);
+  writer.join();
+  close(fds[0]);
+
+  REQUIRE(records.size() == 200);
+  REQUIRE(records.front() == "rec0");
+  REQUIRE(records.back() == "rec199");
+
+  // without a delimiter an item completes once something follows it
+  PushParser<size_t> numbers(skipPostWhitespace(PosNum));
+  numbers.feed("12");
+  REQUIRE(!numbers.next().has_value());
+  numbers.feed("3 4");
+  REQUIRE(numbers.next() == 123);
+  REQUIRE(!numbers.next().has_value());
+  REQUIRE(numbers.finish() == PushParser<size_t>::Status::Done);
+  REQUIRE(numbers.next() == 4);
+
+  PushParser<size_t> broken(PosNum);
+  broken.feed("12x");
+  REQUIRE(broken.next() == 12);
+  REQUIRE(broken.finish() == PushParser<size_t>::Status::Error);
+}
+
+Parser<char> nestedParens() {
+  static const auto inner = lazy<char>([] { return nestedParens(); });
+  return Character('x') ||
+         zipAndGet<1>(Character('('), inner, Character(')'));
+}
+
+// ThreadSanitizer's shadow memory for a stack this deep doesn't fit in a
+// test run, the TSan build only checks the shared-parser tests
+#if !defined(__SANITIZE_THREAD__)
+TEST_CASE("Deep recursion grows the stack") {
+  const std::size_t depth = 20000;
+  std::string input = std::string(depth, '(') + "x" + std::string(depth, ')');
+  auto nested = nestedParens().parse(input);
+  REQUIRE(nested.has_value());
+  REQUIRE(nested.value() == std::pair<char, string_view>('x', ""));
+  input.pop_back();
+  REQUIRE(!nestedParens().parse(input).has_value());
+
+  // exceptions unwind through the extra segments
+  auto throwing = lazy<char>([] {
+    return Character('y').orThrow("Couldnt parse y");
+  });
+  REQUIRE_THROWS(zipAndGet<1>(nestedParens(), throwing)
+                     .parse(std::string(depth, '(') + "x" +
+                            std::string(depth, ')') + "z"));
+
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Right),
+                              PREFIX("-", "Neg", Assoc::Right)};
+  std::string negations = std::string(depth, '-') + "1+1";
+  auto expr = buildExpressionParser(table, Digit).parse(negations);
+  REQUIRE(expr.has_value());
+  REQUIRE(expr.value().second == "");
+}
+#endif
+
+TEST_CASE("Grammar optimizer passes") {
+  namespace G = cpparsec::Grammar;
+  auto lower_alpha = G::Char.filter([](char c) { return std::isalpha(c); })
+                         .filter([](char c) { return std::islower(c); });
+  auto rule = G::oneOf(G::String("let").andThen(G::Character('s')),
+                       G::String("letter"), G::Class(CharSet(), "Nothing"),
+                       lower_alpha.oneOrMore(), G::String("let"),
+                       G::Optional(G::Digit), G::String("x"));
+  std::ostringstream log;
+  auto optimized = G::optimize(rule, &log);
+  REQUIRE(G::describe(optimized) ==
+          "oneOf(zipMany(String(\"let\"), oneOf(String(\"s\"), "
+          "String(\"ter\"))), Char.filter(pred).filter(pred).oneOrMore(), "
+          "String(\"let\"), Optional(Digit))");
+  REQUIRE(log.str().find("before:\n  oneOf\n    zipMany\n") == 0);
+  REQUIRE(log.str().find("after:\n") != std::string::npos);
+
+  auto before = G::lower(rule), after = G::lower(optimized);
+  for (string_view input :
+       {"lets", "letter", "letx", "abc", "let1", "9", "", "x", "LET"}) {
+    REQUIRE(before.parse(input) == after.parse(input));
+  }
+  REQUIRE(after.parse("letters").value().first == "letter");
+}
+
+TEST_CASE("Shared grammar across threads") {
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left)};
+  auto operand = memoize(skipSurrWhitespace(PosNum));
+  const auto grammar = buildExpressionParser(table, operand);
+  const auto regex = Regex("a*.b");
+
+  auto run = [&](ParseContext &ctx, int i) {
+    std::string input = std::to_string(i) + " + 2 * 3 + " + std::to_string(i);
+    auto expr = ctx.run(grammar, input);
+    std::ostringstream out;
+    out << expr.value().first << regex.parse("aab").value().first;
+    ctx.state<std::vector<int>>().push_back(i);
+    return out.str();
+  };
+
+  std::vector<std::string> expected;
+  {
+    ParseContext ctx;
+    for (int i = 0; i < 64; i++)
+      expected.push_back(run(ctx, i));
+  }
+
+  std::vector<std::string> results(8 * 64);
+  std::vector<std::size_t> states(8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      ParseContext ctx; // memo tables and scratch state are per thread
+      for (int i = 0; i < 64; i++)
+        results[t * 64 + i] = run(ctx, i);
+      states[t] = ctx.state<std::vector<int>>().size();
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (int t = 0; t < 8; t++) {
+    REQUIRE(states[t] == 64);
+    for (int i = 0; i < 64; i++)
+      REQUIRE(results[t * 64 + i] == expected[i]);
+  }
+  REQUIRE(ParseContext::current() == nullptr);
+}
+
+TEST_CASE("Memoization is per run") {
+  // one reused context and one buffer: every input sits at the same address
+  // with the same length, so only the run tells the entries apart
+  auto number = memoize(PosNum);
+  ParseContext ctx;
+  std::string buffer = "111";
+  for (char digit : {'1', '2', '3'}) {
+    buffer.assign(3, digit);
+    auto res = ctx.run(number, buffer);
+    REQUIRE(res.value().first == std::size_t(111) * (digit - '0'));
+  }
+
+  // a nested run is part of the outer one and keeps its entries
+  std::size_t generation = ctx.generation();
+  auto nested = Parser<std::size_t>([&](string_view str) {
+    REQUIRE(ctx.generation() == generation + 1);
+    return ctx.run(number, str);
+  });
+  REQUIRE(ctx.run(nested, buffer).value().first == 333);
+  REQUIRE(ctx.generation() == generation + 1);
+}
+
+TEST_CASE("Parsing into columns") {
+  std::vector<size_t> ids;
+  std::vector<char> tags;
+  Columns columns(ids, tags);
+  columns.reserve(8);
+  auto rows = sepByInto(zip(PosNum, Alpha), Character(','), columns);
+
+  REQUIRE(rows.parse("1a,22b,333c") ==
+          std::make_pair(size_t(3), string_view("")));
+  REQUIRE(ids == std::vector<size_t>{1, 22, 333});
+  REQUIRE(tags == std::vector<char>{'a', 'b', 'c'});
+  // a failed parse leaves the columns as they were
+  REQUIRE(!rows.parse("4d,5e,").has_value());
+  REQUIRE(ids.size() == 3);
+  REQUIRE(tags.size() == 3);
+  REQUIRE(rows.parse("") == std::make_pair(size_t(0), string_view("")));
+
+  std::vector<size_t> numbers;
+  auto many = zeroOrMoreInto(skipPostWhitespace(PosNum), Columns(numbers));
+  REQUIRE(many.parse("7 8 9x") == std::make_pair(size_t(3), string_view("x")));
+  REQUIRE(numbers == std::vector<size_t>{7, 8, 9});
+  REQUIRE(!oneOrMoreInto(PosNum, Columns(numbers)).parse("x").has_value());
+}
+
+TEST_CASE("Adaptive alternation") {
+  auto word = [](string_view w) {
+    return String(w).map<std::string>(
+        [](string_view s) { return std::make_optional(std::string(s)); });
+  };
+  auto number = PosNum.map<std::string>(
+      [](size_t n) { return std::make_optional(std::to_string(n)); });
+  auto name = Alpha.oneOrMore().map<std::string>([](std::vector<char> v) {
+    return std::make_optional(std::string(v.begin(), v.end()));
+  });
+
+  AdaptiveChoice<std::string> choice(
+      {withFirst(word("let"), charSetOf('l')),
+       withFirst(number, charSetWhere([](char c) { return std::isdigit(c); })),
+       name, assumeDisjoint(word("@"))},
+      {.sample_every = 1, .reorder_every = 8});
+  Parser<std::string> adaptive = choice;
+  auto fixed = oneOf(word("let"), number, name, word("@"));
+
+  REQUIRE(choice.commutes(0, 1));
+  REQUIRE(!choice.commutes(0, 2));
+  REQUIRE(choice.commutes(2, 3));
+  REQUIRE(choice.order() == std::vector<std::size_t>{0, 1, 2, 3});
+
+  for (int i = 0; i < 64; i++)
+    REQUIRE(adaptive.parse("@x") == fixed.parse("@x"));
+  // "@" is marked disjoint, so it may move all the way to the front
+  REQUIRE(choice.order() == std::vector<std::size_t>{3, 0, 1, 2});
+  for (int i = 0; i < 64; i++)
+    REQUIRE(adaptive.parse("42") == fixed.parse("42"));
+  REQUIRE(choice.order() == std::vector<std::size_t>{1, 3, 0, 2});
+  // the unhinted name may overlap with "let", so it stays behind it
+  for (int i = 0; i < 64; i++)
+    REQUIRE(adaptive.parse("abc") == fixed.parse("abc"));
+  REQUIRE(choice.order() == std::vector<std::size_t>{1, 3, 0, 2});
+
+  // the order never changes a result
+  for (string_view input : {"let", "lex", "12x", "abc", "@", "", "-", "l"})
+    REQUIRE(adaptive.parse(input) == fixed.parse(input));
+
+  // each choice counts its own successes, whatever else runs in between
+  auto digits = charSetWhere([](char c) { return std::isdigit(c); });
+  AdaptiveChoice<std::string> sampled(
+      {withFirst(word("let"), charSetOf('l')), withFirst(number, digits)},
+      {.sample_every = 2, .reorder_every = 1});
+  AdaptiveChoice<std::string> other({withFirst(number, digits)},
+                                    {.sample_every = 2, .reorder_every = 1});
+  for (int i = 0; i < 2; i++) {
+    REQUIRE(sampled.parser().parse("7").has_value());
+    REQUIRE(other.parser().parse("7").has_value());
+  }
+  REQUIRE(sampled.order() == std::vector<std::size_t>{1, 0});
+
+  namespace G = Grammar;
+  auto branch = branchOf(G::String("if").andThen(G::Digit));
+  REQUIRE(branch.first.value() == charSetOf('i'));
+  REQUIRE(!branchOf(G::Optional(G::Digit)).first.has_value());
+}
+
+TEST_CASE("Commit points") {
+  auto text = [](const std::vector<char> &v) {
+    return std::make_optional(std::string(v.begin(), v.end()));
+  };
+  auto name = Alpha.oneOrMore().map<std::string>(text);
+  auto binding =
+      commit(String("let "), name, Character('='),
+             Digit.oneOrMore().map<std::string>(text))
+          .map<std::string>([](const auto &t) {
+            return std::make_optional("let " + std::get<3>(t));
+          });
+  auto statement = binding || name;
+
+  REQUIRE(statement.parse("let x=1").value().first == "let 1");
+  REQUIRE(statement.parse("letter").value().first == "letter");
+  // past "let " there's no going back to the identifier alternative
+  REQUIRE_THROWS_AS(statement.parse("let =1"), ParseError);
+  REQUIRE((attempt(binding) || name).parse("let =1").value().first == "let");
+
+  // inside a context a commit also stops enclosing combinators from
+  // rewinding, and the input before it is released
+  auto program = commit(statement, Character(';')).zeroOrMore();
+  ParseContext ctx;
+  REQUIRE(ctx.run(program, "a;let b=2;").value().second == "");
+  REQUIRE_THROWS_AS(ctx.run(program, "a;b"), ParseError);
+  auto marked = Optional(zip(commit(Character('x')), Character('y')));
+  REQUIRE(marked.parse("xz").value() == std::make_pair(false, string_view("xz")));
+  REQUIRE_THROWS_AS(ctx.run(marked, "xz"), ParseError);
+  REQUIRE(ctx.run(attempt(marked) || Optional(Character('x')), "xz").value() ==
+          std::make_pair(true, string_view("z")));
+  auto checked = zipAndGet<0>(program, Parser<bool>([&](string_view str) {
+                                REQUIRE(ctx.offset(str) == 4);
+                                // right after the last statement
+                                REQUIRE(ctx.committed() == 3);
+                                return std::make_optional(
+                                    std::make_pair(true, str));
+                              }));
+  REQUIRE(ctx.run(checked, "a;b;").has_value());
+  REQUIRE(ctx.committed() == 0);
+}
+
+TEST_CASE("Binary Expr serialization") {
+  using Atom = std::variant<std::string, int>;
+  auto atom = oneOf(Alpha.oneOrMore().map<Atom>([](std::vector<char> v) {
+    return std::make_optional<Atom>(std::string(v.begin(), v.end()));
+  }),
+                    PosNum.map<Atom>([](size_t n) {
+                      return std::make_optional<Atom>(int(n));
+                    }));
+  std::vector<ExprType> table{
+      INFIX("=", "Assign", Assoc::Right), INFIX("+", "Add", Assoc::Left),
+      INFIX("*", "Mul", Assoc::Left), PREFIX("++", "PreIncr", Assoc::Right)};
+  auto expr = buildExpressionParser(table, atom).parse("x=1+2*y+++3+x");
+  REQUIRE(expr.has_value());
+  std::string bytes = serializeExpr(expr.value().first);
+  ExprView<Atom> view(bytes);
+  auto root = view.root();
+  REQUIRE(root.kind() == ExprOp::Infix);
+  REQUIRE(root.op() == "Assign");
+  REQUIRE(root.lhs().is_leaf());
+  REQUIRE(root.lhs().leaf() == Atom(std::string("x")));
+  REQUIRE(root.rhs().op() == "Add");
+  REQUIRE(serializeExpr(view.to_expr()) == bytes);
+  // names and leaves are stored once
+  REQUIRE(bytes.find("Add") == bytes.rfind("Add"));
+
+  bytes[4] = 2;
+  REQUIRE_THROWS(ExprView<Atom>(bytes));
+  REQUIRE_THROWS(ExprView<Atom>(string_view(bytes).substr(0, 30)));
+
+  // deep trees round trip through a mapped file
+  std::vector<ExprType> negation{PREFIX("-", "Neg", Assoc::Right),
+                                 INFIX("+", "Add", Assoc::Left)};
+  std::string input = std::string(5000, '-') + "1+1";
+  auto deep = buildExpressionParser(negation, Digit).parse(input);
+  char path[] = "/tmp/cpparsec_exprXXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  std::string deep_bytes = serializeExpr(deep.value().first);
+  REQUIRE(write(fd, deep_bytes.data(), deep_bytes.size()) ==
+          ssize_t(deep_bytes.size()));
+  close(fd);
+  {
+    MappedFile file(path);
+    ExprView<char> deep_view(file.bytes());
+    REQUIRE(deep_view.root().op() == "Neg");
+    REQUIRE(deep_view.root().child().kind() == ExprOp::Prefix);
+    REQUIRE(serializeExpr(deep_view.to_expr()) == deep_bytes);
+  }
+  unlink(path);
+}
+
+TEST_CASE("Incremental reparsing") {
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left),
+                              PREFIX("-", "Neg", Assoc::Right)};
+  IncrementalExpr<char> doc(table, Digit);
+
+  std::string text = "1*2";
+  for (int i = 0; i < 200; i++)
+    text += "+3*4";
+  auto first = doc.parse(text);
+  REQUIRE(first.has_value());
+  REQUIRE(first.value().second == "");
+  std::size_t full = doc.stats().searched;
+  // the left operand of the first + was searched with the rest of the table
+  REQUIRE(doc.remembered(0, 3, 1).value().value().first->op == "Mul");
+
+  // same answer as parsing the edited text from scratch, which hash-conses
+  // to the same node
+  auto check = [&](IncrementalExpr<char>::Result res) {
+    REQUIRE(res.has_value());
+    IncrementalExpr<char> fresh(table, Digit);
+    std::ostringstream expected, actual;
+    expected << ExprInterner<char>::to_expr(
+        fresh.parse(doc.text()).value().first);
+    actual << ExprInterner<char>::to_expr(res.value().first);
+    REQUIRE(actual.str() == expected.str());
+  };
+
+  // the first operand: everything after the edit is reused
+  check(doc.edit(0, 1, "7"));
+  REQUIRE(doc.stats().searched * 20 < full);
+  REQUIRE(doc.stats().recalled > 0);
+  REQUIRE(doc.text().starts_with("7*2+3*4"));
+
+  // insertion in the middle keeps both sides
+  check(doc.edit(400, 0, "-5*"));
+  REQUIRE(doc.stats().kept > 0);
+  REQUIRE(doc.stats().dropped > 0);
+  REQUIRE(doc.stats().searched * 2 < full);
+
+  // an edit that breaks the document, and the one that repairs it
+  auto broken = doc.edit(3, 0, "+");
+  REQUIRE((!broken.has_value() || broken.value().second != ""));
+  check(doc.edit(3, 1, ""));
+  REQUIRE(doc.text().substr(0, 7) == "7*2+3*4");
+
+  // nodes of text that was edited away pile up until compact drops them
+  check(doc.compact());
+  std::size_t live = doc.interner().size();
+  for (int i = 0; i < 60; i++) {
+    std::string digit(1, char('1' + i % 9));
+    doc.edit(8 * (i % 30), 1, digit);
+    if (i % 10 == 9) {
+      REQUIRE(doc.interner().size() > live + 100);
+      check(doc.compact());
+      REQUIRE(doc.interner().size() < live + 20);
+    }
+  }
+  // the remembered ranges point into the compacted interner
+  check(doc.edit(0, 1, "8"));
+  REQUIRE(doc.stats().searched * 20 < full);
+
+  REQUIRE_THROWS_AS(doc.edit(doc.text().size() + 1, 0, "1"), std::out_of_range);
+}
+
+TEST_CASE("Parallel sepBy") {
+  std::string numbers;
+  for (int i = 0; i < 5000; i++) {
+    numbers += std::to_string(i * 7);
+    if (i + 1 < 5000)
+      numbers += ',';
+  }
+  ParallelSplit split{.threads = 4, .min_chunk = 256};
+  auto sequential = sepBy(PosNum, Character(','));
+  auto parallel = parallelSepBy(PosNum, ',', split);
+
+  auto expected = sequential.parse(numbers);
+  auto res = parallel.parse(numbers);
+  REQUIRE(res.has_value());
+  REQUIRE(res.value().first.size() == 5000);
+  REQUIRE(res.value().first == expected.value().first);
+  REQUIRE(res.value().second == "");
+
+  // small inputs and malformed ones behave like sepBy
+  REQUIRE(parallel.parse("1,2,3").value().first ==
+          std::vector<size_t>{1, 2, 3});
+  REQUIRE(parallel.parse("").value().first.empty());
+  std::string broken = numbers;
+  broken[broken.size() / 2] = ';';
+  REQUIRE(!parallel.parse(broken).has_value());
+  REQUIRE(!parallel.parse(numbers + ",").has_value());
+
+  // commas inside brackets make wrong guesses, which fall back to the
+  // sequential parse unless the split knows about the brackets
+  auto group = zipAndGet<1>(Character('['), Char_excluding(']').zeroOrMore(),
+                            Character(']'));
+  std::string groups;
+  for (int i = 0; i < 3000; i++) {
+    groups += '[';
+    groups += std::to_string(i);
+    groups += ",x,,y]";
+    if (i + 1 < 3000)
+      groups += ',';
+  }
+  auto want = sepBy(group, Character(',')).parse(groups).value().first;
+  REQUIRE(want.size() == 3000);
+  REQUIRE(parallelSepBy(group, ',', split).parse(groups).value().first == want);
+  split.open = "[";
+  split.close = "]";
+  REQUIRE(parallelSepBy(group, ',', split).parse(groups).value().first == want);
+  REQUIRE(parallel::splitPoints(groups, ',', 4, split).size() == 4);
+
+  // a wrong guess inside a group lands on a number that doesn't fit, the
+  // piece is dropped instead of the exception escaping
+  auto big = "99999999999999999999999";
+  auto item = group || PosNum.map<std::vector<char>>([](size_t) {
+    return std::make_optional(std::vector<char>{});
+  });
+  std::string overflowing;
+  for (int i = 0; i < 3000; i++) {
+    overflowing += "[x,";
+    overflowing += big;
+    overflowing += i + 1 < 3000 ? "]," : "]";
+  }
+  split.open = "";
+  split.close = "";
+  want = sepBy(item, Character(',')).parse(overflowing).value().first;
+  REQUIRE(parallelSepBy(item, ',', split).parse(overflowing).value().first ==
+          want);
+  // a number that really doesn't fit still throws
+  REQUIRE_THROWS_AS(
+      parallelSepBy(item, ',', split).parse(overflowing + "," + big),
+      std::out_of_range);
+}
+
+TEST_CASE("Allocation budgets") {
+  // upper bounds for what one parse may allocate, lower them when a change
+  // makes a parser cheaper
+  REQUIRE(alloc::counting());
+  auto allocations = [](const auto &parser, string_view input) {
+    auto [res, usage] = alloc::measure(parser, input);
+    REQUIRE(res.has_value());
+    return usage.allocations;
+  };
+
+  REQUIRE(allocations(PosNum, "1234567 rest") == 0);
+  REQUIRE(allocations(Grammar::compile(Grammar::Alpha.oneOrMore()).parser,
+                      "identifier rest") == 0);
+  REQUIRE(allocations(Alpha.oneOrMoreSlice(), "identifier rest") == 0);
+  REQUIRE(allocations(Alpha.oneOrMore(), "identifier rest") <= 6);
+
+  std::string list;
+  for (int i = 0; i < 100; i++)
+    list += std::to_string(i) + (i < 99 ? "," : "");
+  REQUIRE(allocations(sepBy(PosNum, Character(',')), list) <= 10);
+
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left)};
+  REQUIRE(allocations(buildExpressionParser(table, Digit), "1+2*3+4") <= 6);
+
+  auto usage = alloc::count([] { std::vector<int> v(1000); });
+  REQUIRE(usage.allocations == 1);
+  REQUIRE(usage.bytes == 1000 * sizeof(int));
+  // over-aligned allocations go through their own operator new
+  struct alignas(64) Line {
+    char bytes[64];
+  };
+  usage = alloc::count([] { std::vector<Line> v(4); });
+  REQUIRE(usage.allocations == 1);
+  REQUIRE(usage.bytes == 4 * sizeof(Line));
+}
+
+TEST_CASE("Parse budgets") {
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left),
+                              INFIX("-", "Sub", Assoc::Left)};
+  auto expr = buildExpressionParser(table, Digit);
+  // each * is tried as a split before the dangling + fails, so the search
+  // takes time quadratic in the length
+  std::string crafted;
+  for (int i = 0; i < 3000; i++)
+    crafted += "1*";
+  crafted += "+";
+
+  ParseContext ctx;
+  REQUIRE(ctx.run(expr, "1+2*3").has_value());
+  REQUIRE(ctx.status() == ParseStatus::Ok);
+  REQUIRE(ctx.steps() == 0); // nothing is counted without a budget
+  REQUIRE(!ctx.run(expr, "+").has_value());
+  REQUIRE(ctx.status() == ParseStatus::NoMatch);
+
+  ctx.setBudget(Budget{.max_steps = 10000, .max_depth = 0, .max_time = {}});
+  REQUIRE(ctx.run(expr, "1+2*3").has_value());
+  REQUIRE(ctx.status() == ParseStatus::Ok);
+  REQUIRE(ctx.steps() > 0);
+  REQUIRE(!ctx.run(expr, crafted).has_value());
+  REQUIRE(ctx.status() == ParseStatus::StepLimit);
+  REQUIRE(ctx.steps() == 10000);
+
+  // attempt doesn't hide an exhausted budget
+  REQUIRE(!ctx.run(attempt(expr) || expr, crafted).has_value());
+  REQUIRE(ctx.status() == ParseStatus::StepLimit);
+
+  std::string nested(5000, '(');
+  std::function<Parser<size_t>()> deep = [&] {
+    return Parens(lazy<size_t>(deep)) || PosNum;
+  };
+  nested += "1" + std::string(5000, ')');
+  ctx.setBudget(Budget{.max_steps = 0, .max_depth = 100, .max_time = {}});
+  REQUIRE(!ctx.run(deep(), nested).has_value());
+  REQUIRE(ctx.status() == ParseStatus::DepthLimit);
+  REQUIRE(ctx.run(deep(), "((7))").value().first == 7);
+
+  ctx.setBudget(Budget{.max_time = std::chrono::milliseconds(20)});
+  auto start = std::chrono::steady_clock::now();
+  REQUIRE(!ctx.run(expr, crafted).has_value());
+  REQUIRE(ctx.status() == ParseStatus::Deadline);
+  REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+
+  // threads of parallelSepBy count against the same budget
+  std::string numbers;
+  for (int i = 0; i < 5000; i++) {
+    numbers += std::to_string(i);
+    if (i + 1 < 5000)
+      numbers += ',';
+  }
+  auto list = parallelSepBy(PosNum, ',', {.threads = 4, .min_chunk = 256});
+  ctx.setBudget(Budget{.max_steps = 1000000, .max_depth = 0, .max_time = {}});
+  REQUIRE(ctx.run(list, numbers).value().first.size() == 5000);
+  REQUIRE(ctx.steps() > 5000);
+  ctx.setBudget(Budget{.max_steps = 1000, .max_depth = 0, .max_time = {}});
+  REQUIRE(!ctx.run(list, numbers).has_value());
+  REQUIRE(ctx.status() == ParseStatus::StepLimit);
+
+  ctx.setBudget(Budget{});
+  REQUIRE(ctx.run(expr, "1*2").has_value());
+  REQUIRE(ctx.status() == ParseStatus::Ok);
+}
+
+TEST_CASE("UTF-8 character classes") {
+  REQUIRE(utf8::valid("plain ascii"));
+  REQUIRE(utf8::valid("gr\xc3\xbc\xc3\x9f \xe6\x97\xa5\xe6\x9c\xac "
+                      "\xf0\x9f\x98\x80"));
+  REQUIRE(!utf8::valid("\xc0\xaf"));         // overlong '/'
+  REQUIRE(!utf8::valid("\xed\xa0\x80"));     // surrogate
+  REQUIRE(!utf8::valid("\xf4\x90\x80\x80")); // past U+10FFFF
+  REQUIRE(!utf8::valid("\xe6\x97"));         // truncated
+  std::string long_ascii(40, 'a');
+  REQUIRE(utf8::asciiPrefix(long_ascii) == 40);
+  REQUIRE(!utf8::valid(long_ascii + "\xff" + long_ascii));
+  REQUIRE(utf8::asciiPrefix(long_ascii + "\xc3\xa9") == 40);
+
+  REQUIRE(utf8::decode("\xe2\x82\xac").value().code_point == U'€');
+  REQUIRE(unicode::category(U'A') == unicode::Category::Lu);
+  REQUIRE(unicode::category(U'١') == unicode::Category::Nd);
+  REQUIRE(unicode::category(U'　') == unicode::Category::Zs);
+  REQUIRE(unicode::isXidStart(U'Ω'));
+  REQUIRE(!unicode::isXidStart(U'١'));
+  REQUIRE(unicode::isXidContinue(U'١'));
+
+  // byte-wise Alpha splits a non-ASCII identifier, the UTF-8 classes don't
+  string_view input = "stra\xc3\x9f" "e = 1";
+  REQUIRE(Alpha.oneOrMoreSlice().parse(input).value().first == "stra");
+  REQUIRE(Utf8Alpha.oneOrMoreSlice().parse(input).value().first ==
+          "stra\xc3\x9f" "e");
+  REQUIRE(Utf8Digit.parse("\xd9\xa1!").value().first == U'١');
+  REQUIRE(Utf8WhiteSpace.parse("\xe3\x80\x80x").value().second == "x");
+  REQUIRE(!Utf8Char.parse("\xc3").has_value());
+
+  auto ident = Identifier.parse("\xe6\x97\xa5\xe6\x9c\xac_2x+1");
+  REQUIRE(ident.value().first == "\xe6\x97\xa5\xe6\x9c\xac_2x");
+  REQUIRE(ident.value().second == "+1");
+  REQUIRE(Identifier.parse("_tmp").value().first == "_tmp");
+  REQUIRE(!Identifier.parse("1abc").has_value());
+  REQUIRE(!Identifier.parse("\xd9\xa1" "a").has_value());
+}
+
+TEST_CASE("Applicative combinators") {
+  auto digit = Digit.map([](char c) { return std::make_optional(c - '0'); });
+  auto even = digit.filter([](int d) { return d % 2 == 0; });
+  REQUIRE(digit.parse("7x").value() == std::make_pair(7, string_view("x")));
+  REQUIRE(even.parse("4").value().first == 4);
+  REQUIRE(!even.parse("3").has_value());
+  // neither builds anything per match
+  REQUIRE(alloc::measure(even, "4").second.allocations == 0);
+
+  auto pair = seq([](int a, char, int b) { return a * 10 + b; }, digit,
+                  Character(','), digit);
+  REQUIRE(pair.parse("1,2;").value() == std::make_pair(12, string_view(";")));
+  REQUIRE(!pair.parse("1,;").has_value());
+  REQUIRE(alloc::measure(pair, "1,2").second.allocations == 0);
+
+  REQUIRE(seqLeft(digit, Character(';')).parse("5;").value().first == 5);
+  REQUIRE(seqRight(Character('-'), digit).parse("-5").value().first == 5);
+  REQUIRE(!seqRight(Character('-'), digit).parse("-").has_value());
+
+  auto negate = Character('-').map([](char) {
+    return std::make_optional(std::function<int(int)>(std::negate<int>()));
+  });
+  REQUIRE(ap(negate, digit).parse("-3").value().first == -3);
+}
+
+TEST_CASE("Fused expression evaluation") {
+  std::vector<ExprType> table{
+      INFIX("+", "Add", Assoc::Left), INFIX("-", "Sub", Assoc::Left),
+      INFIX("*", "Mul", Assoc::Left), PREFIX("~", "Neg", Assoc::Right)};
+  ExprActions<char, int> actions{
+      [](char c) { return c - '0'; },
+      {{"Neg", std::negate<int>()}},
+      {{"Add", std::plus<int>()},
+       {"Sub", std::minus<int>()},
+       {"Mul", std::multiplies<int>()}}};
+  auto fused = buildExpressionParser(table, Digit, actions);
+
+  REQUIRE(fused.parse("1+2*3").value() == std::make_pair(7, string_view("")));
+  REQUIRE(fused.parse("~2*3+1)").value() ==
+          std::make_pair(-5, string_view(")")));
+  REQUIRE(!fused.parse("+").has_value());
+
+  // same grouping as the trees of buildExpressionParser
+  ExprInterner<char> interner;
+  auto dag = buildHashConsedExpressionParser(table, Digit, interner);
+  MemoEvaluator<char, int> eval(
+      [](const ExprNode<char> &node, auto &self) -> int {
+        if (node.is_leaf())
+          return node.leaf - '0';
+        if (node.op == "Neg")
+          return -self(node.lhs);
+        int lhs = self(node.lhs), rhs = self(node.rhs);
+        return node.op == "Add" ? lhs + rhs
+               : node.op == "Sub" ? lhs - rhs
+                                  : lhs * rhs;
+      });
+  for (string_view input : {"8-3-2", "9-1-2-3", "2*3-4*5-6", "~1-2-3+4"})
+    REQUIRE(fused.parse(input).value().first ==
+            eval(dag.parse(input).value().first));
+
+  // no tree, nothing to allocate
+  auto [res, usage] = alloc::measure(fused, "1*2+3*4-5*6+7*8-9");
+  REQUIRE(res.has_value());
+  REQUIRE(usage.allocations == 0);
+
+  actions.binary.erase("Sub");
+  REQUIRE_THROWS_AS(buildExpressionParser(table, Digit, actions),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Memory resources") {
+  std::string list;
+  for (int i = 0; i < 100; i++)
+    list += std::to_string(i) + (i < 99 ? "," : "");
+
+  // with nothing behind the buffer, any allocation outside of it throws
+  std::array<std::byte, 1 << 14> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  ParseContext ctx;
+  ctx.setMemoryResource(&arena);
+  REQUIRE(ctx.memoryResource() == &arena);
+
+  auto numbers = pmrSepBy(PosNum, Character(','));
+  auto usage = alloc::count([&] {
+    auto res = ctx.run(numbers, list);
+    REQUIRE(res.has_value());
+    REQUIRE(res.value().first.size() == 100);
+    REQUIRE(res.value().first.get_allocator().resource() == &arena);
+  });
+  REQUIRE(usage.allocations == 0);
+  REQUIRE(memory::resource() == std::pmr::get_default_resource());
+
+  // a commit inside the first item forbids going back to an empty list
+  auto marked = pmrSepBy(zip(commit(Character('x')), Character('y')),
+                         Character(','));
+  REQUIRE(marked.parse("xz").value().first.empty());
+  REQUIRE_THROWS_AS(ctx.run(marked, "xz"), ParseError);
+
+  auto words = pmrOneOrMore(Alpha);
+  REQUIRE(ctx.run(words, "abc1").value().first.size() == 3);
+  REQUIRE(!ctx.run(words, "1").has_value());
+  // outside of a run the default resource is used
+  REQUIRE(words.parse("ab").value().first.get_allocator().resource() ==
+          std::pmr::get_default_resource());
+
+  // a nested context without its own resource keeps the outer one
+  ParseContext inner;
+  auto nested = Parser<bool>([&](string_view str) {
+    auto res = inner.run(pmrZeroOrMore(Digit), str);
+    bool same = res.value().first.get_allocator().resource() == &arena;
+    return std::make_optional(std::make_pair(same, str));
+  });
+  REQUIRE(ctx.run(nested, "12").value().first);
+
+  // hash-consed trees live entirely in the arena
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left)};
+  std::pmr::monotonic_buffer_resource tree_arena;
+  ExprInterner<char> interner(&tree_arena);
+  auto expr = buildHashConsedExpressionParser(table, Digit, interner);
+  usage = alloc::count([&] {
+    REQUIRE(expr.parse("1*2+3*4+1*2").has_value());
+  });
+  REQUIRE(interner.size() == 9);
+  REQUIRE(usage.allocations <= 2); // the arena's own blocks
+}
+
+TEST_CASE("Backtracking heatmap") {
+  auto word = oneOf(named("try", recognize(zip(Alpha, Character(';')))),
+                    named("fallback", Alpha.oneOrMoreSlice()));
+  heat::Heatmap map;
+  ParseContext ctx;
+  ctx.setHeatmap(&map);
+  REQUIRE(ctx.run(word, "ab").has_value());
+  REQUIRE(heat::recorder == nullptr);
+
+  // try reads a and b, fails, and fallback reads both again
+  REQUIRE(map.input() == "ab");
+  REQUIRE(map.counts() == std::vector<std::uint32_t>{2, 2});
+  REQUIRE(map.reads() == 4);
+  const auto &sources = map.sources();
+  REQUIRE(sources.size() == 3);
+  REQUIRE(sources[1].name == "try");
+  REQUIRE(sources[1].rereads == 0);
+  REQUIRE(sources[2].name == "fallback");
+  REQUIRE(sources[2].rereads == 2);
+
+  auto hot = map.hot(1);
+  REQUIRE(hot.size() == 1);
+  REQUIRE(hot[0].begin == 0);
+  REQUIRE(hot[0].end == 2);
+  REQUIRE(hot[0].max == 2);
+  REQUIRE(hot[0].parser == "try");
+  REQUIRE(map.hot(2).empty());
+
+  REQUIRE(map.text(1).find("ab\n22\n") != std::string::npos);
+  REQUIRE(map.csv() == "offset,count,parser\n0,2,\"try\"\n1,2,\"try\"\n");
+  REQUIRE(map.json(1) ==
+          "{\"size\":2,\"counts\":[2,2],\"parsers\":["
+          "{\"name\":\"(unnamed)\",\"reads\":0,\"rereads\":0},"
+          "{\"name\":\"try\",\"reads\":2,\"rereads\":0},"
+          "{\"name\":\"fallback\",\"reads\":2,\"rereads\":2}],"
+          "\"hot\":[{\"begin\":0,\"end\":2,\"max\":2,\"parser\":\"try\"}]}");
+
+  // every run starts over, and String reports what it compared
+  REQUIRE(ctx.run(String("abc") || String("abd"), "abd").has_value());
+  REQUIRE(map.counts() == std::vector<std::uint32_t>{2, 2, 2});
+  // a full match reads only the prefix, not the byte after it
+  REQUIRE(ctx.run(String("abc") || String("abd"), "abdX").has_value());
+  REQUIRE(map.counts() == std::vector<std::uint32_t>{2, 2, 2, 0});
+
+  // a captureless wrapper is not a primitive, only Digit reports the byte
+  Parser<char> wrapped([](string_view str) { return Digit.parse(str); });
+  REQUIRE(ctx.run(wrapped, "1").has_value());
+  REQUIRE(map.counts() == std::vector<std::uint32_t>{1});
+
+  // with a dangling +, the operator search parses the products before it
+  // again for every split it tries
+  std::vector<ExprType> table{INFIX("+", "Add", Assoc::Left),
+                              INFIX("*", "Mul", Assoc::Left)};
+  auto expr = buildExpressionParser(table, named("digit", Digit));
+  REQUIRE(ctx.run(expr, "1*2*3+").has_value());
+  REQUIRE(map.counts()[4] > 2);
+  REQUIRE(map.hot(2).front().parser == "digit");
+
+  ctx.setHeatmap(nullptr);
+  REQUIRE(ctx.run(word, "cd").has_value());
+  REQUIRE(map.input() == "1*2*3+");
+}
+
+TEST_CASE("Search combinators") {
+  // every mode of ByteFinder agrees with a plain scan
+  std::string text;
+  for (int i = 0; i < 1000; i++)
+    text += char('a' + (i * 7919) % 26);
+  text += "#tail";
+  std::vector<CharSet> sets{
+      charSetOf('#'),
+      charSetOf('#') | charSetOf('z'),
+      ~(charSetOf('a') | charSetOf('b')),
+      charSetWhere([](char c) { return c >= 'w' && c <= 'z'; }) |
+          charSetWhere([](char c) { return c >= '0' && c <= '9'; }),
+      CharSet(),
+  };
+  for (const auto &set : sets) {
+    search::ByteFinder finder(set);
+    for (std::size_t from : {0, 1, 15, 16, 17, 500, 990, 1003}) {
+      string_view str = string_view(text).substr(from);
+      std::size_t expected = string_view::npos;
+      for (std::size_t i = 0; i < str.size(); i++)
+        if (set.test(static_cast<unsigned char>(str[i]))) {
+          expected = i;
+          break;
+        }
+      REQUIRE(finder.find(str) == expected);
+    }
+  }
+  REQUIRE(search::find("abcabd", "abd") == 3);
+  REQUIRE(search::find("abcab", "abd") == string_view::npos);
+  REQUIRE(search::find("ab", "") == 0);
+
+  // comment bodies
+  auto comment = zipAndGet<1>(String("/*"), searchFor("*/"), String("*/"));
+  auto res = comment.parse("/* a * b / c */x");
+  REQUIRE(res.value() == std::make_pair(string_view(" a * b / c "),
+                                        string_view("x")));
+  REQUIRE(!comment.parse("/* open").has_value());
+
+  auto number = skipUntil(PosNum, charSetWhere(primitives::digit));
+  REQUIRE(number.parse("width: 42px").value() ==
+          std::make_pair(std::size_t(42), string_view("px")));
+  REQUIRE(!number.parse("none").has_value());
+  // without a first set every position is tried
+  REQUIRE(skipUntil(String("ab")).parse("aaab!").value().second == "!");
+  auto at_end = End.filter([](bool end) { return end; });
+  REQUIRE(skipUntil(at_end, charSetOf(';')).parse("abc").value().second == "");
+  REQUIRE(skipUntil(at_end).parse("").has_value());
+
+  auto items = manyTill(Digit, Character(';'), charSetOf(';'));
+  auto digits = items.parse("123;rest");
+  REQUIRE(digits.value().first == std::vector<char>{'1', '2', '3'});
+  REQUIRE(digits.value().second == "rest");
+  REQUIRE(items.parse(";").value().first.empty());
+  REQUIRE(!items.parse("12x;").has_value());
+  REQUIRE(!items.parse("12").has_value());
+  REQUIRE(manyTill(Char, at_end).parse("ab").value().first.size() == 2);
+}